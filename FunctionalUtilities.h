@@ -2,20 +2,186 @@
 #define FUTILITIES
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <type_traits>
 #include <vector>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+#ifdef __GNUC__
+    #define FUTILITIES_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+    #define FUTILITIES_ALWAYS_INLINE inline
+#endif
+#ifdef _MSC_VER
+    #define FUTILITIES_PRAGMA(x) __pragma(x)
+#else
+    #define FUTILITIES_PRAGMA(x) _Pragma(#x)
+#endif
+/*simd clauses are OpenMP 4.0; older implementations, eg msvc's 2.0, get the plain loops*/
+#if defined(_OPENMP)&&_OPENMP>=201307
+    #define FUTILITIES_OMP_SIMD FUTILITIES_PRAGMA(omp simd)
+    #define FUTILITIES_OMP_SIMD_REDUCTION(...) FUTILITIES_PRAGMA(omp simd reduction(__VA_ARGS__))
+    #define FUTILITIES_OMP_PARALLEL_FOR_SIMD FUTILITIES_PRAGMA(omp parallel for simd)
+#else
+    #define FUTILITIES_OMP_SIMD
+    #define FUTILITIES_OMP_SIMD_REDUCTION(...)
+    #define FUTILITIES_OMP_PARALLEL_FOR_SIMD FUTILITIES_PRAGMA(omp parallel for)
+#endif
 
 namespace futilities{
     
     
     
+    namespace detail{
+        /**exponentiation by squaring, as a single expression so it is a c++11 constexpr*/
+        template<typename T>
+        constexpr T unsigned_power(const T& base, unsigned int n){
+            return n<=1u?(n==0u?T(1):base):(n&1u?base:T(1))*unsigned_power(base*base, n>>1);
+        }
+        template<typename T>
+        constexpr T square(const T& number){
+            return number*number;
+        }
+    }
+    /**Utility function for integer powers.  
+     * Uses exponentiation by squaring so only O(log N) 
+     * multiplications are needed.  Negative N returns 
+     * the reciprocal and N=0 returns one; for integral T 
+     * the reciprocal truncates, so negative N gives zero 
+     * unless number is 1 or -1.*/
+    template<typename T>
+    constexpr T int_power(const T& number, int N){
+        return N<0?
+            detail::unsigned_power(T(1)/number, 0u-(unsigned int)N):
+            detail::unsigned_power(number, (unsigned int)N);
+    }
     /**Utility function for integer powers.  
-     * Recursively creates powers at compile time.  
-     * Should be extremely fast.*/
+     * Kept for backwards compatibility; see int_power.*/
     template<typename T>
     constexpr T const_power(const T& number, int N ){
-        return (N == 1) ?             // terminal condition
-            number:                   // and terminal value
-            number*const_power(number, N-1); // recursive definition
+        return int_power(number, N);
+    }
+    namespace detail{
+        /**square and multiply chain for a compile time exponent*/
+        template<unsigned int N, bool Odd=(N%2u==1u)>
+        struct power_chain;
+        template<>
+        struct power_chain<0u, false>{
+            template<typename T>
+            static constexpr T apply(const T&){
+                return T(1);
+            }
+        };
+        template<>
+        struct power_chain<1u, true>{
+            template<typename T>
+            static constexpr T apply(const T& number){
+                return number;
+            }
+        };
+        template<unsigned int N>
+        struct power_chain<N, false>{
+            template<typename T>
+            static constexpr T apply(const T& number){
+                return square(power_chain<N/2u>::apply(number));
+            }
+        };
+        template<unsigned int N>
+        struct power_chain<N, true>{
+            template<typename T>
+            static constexpr T apply(const T& number){
+                return number*square(power_chain<N/2u>::apply(number));
+            }
+        };
+    }
+    /**Utility function for integer powers.  
+     * Expands to a square and multiply chain at compile time 
+     * so only O(log N) multiplications are generated.  
+     * Should be extremely fast.  Negative N needs a 
+     * floating point T.*/
+    template<int N, typename T>
+    constexpr T const_power(const T& number){
+        static_assert(N>=0||!std::is_integral<T>::value, "negative powers of an integral type truncate to zero");
+        return N<0?
+            T(1)/detail::power_chain<0u-(unsigned int)N>::apply(number):
+            detail::power_chain<(unsigned int)N>::apply(number);
+    }
+    /**
+        Raises every element of an array to a compile time power.  
+        This function runs in parallel when compiled with openmp enabled
+        @array std-style contiguous container
+        @returns array with every element raised to the power N
+    */
+    template<int N, typename Array>
+    auto for_each_power(Array&& array){
+        const int n=array.size();
+        auto* data=array.data();
+        FUTILITIES_OMP_PARALLEL_FOR_SIMD
+        for(int i=0; i<n; ++i){
+            data[i]=const_power<N>(data[i]);
+        }
+        return std::move(array);
+    }
+    /**
+        Raises every element of an array to a run time integer power.  
+        This function runs in parallel when compiled with openmp enabled
+        @array std-style contiguous container
+        @N power
+        @returns array with every element raised to the power N
+    */
+    template<typename Array>
+    auto for_each_power(Array&& array, int N){
+        typedef std::decay_t<decltype(array[0])> T;
+        constexpr int blockSize=256;
+        const int n=array.size();
+        const unsigned int absN=N<0?0u-(unsigned int)N:(unsigned int)N;
+        T* data=array.data();
+        //the exponent bits are the same for every element so walk
+        //them once per block and vectorize across the block
+        #pragma omp parallel for
+        for(int block=0; block<n; block+=blockSize){
+            const int m=std::min(blockSize, n-block);
+            T base[blockSize];
+            T result[blockSize];
+            for(int i=0; i<m; ++i){
+                base[i]=N<0?T(1)/data[block+i]:data[block+i];
+                result[i]=T(1);
+            }
+            for(unsigned int bits=absN; bits; bits>>=1){
+                if(bits&1u){
+                    FUTILITIES_OMP_SIMD
+                    for(int i=0; i<m; ++i){
+                        result[i]*=base[i];
+                    }
+                }
+                FUTILITIES_OMP_SIMD
+                for(int i=0; i<m; ++i){
+                    base[i]*=base[i];
+                }
+            }
+            for(int i=0; i<m; ++i){
+                data[block+i]=result[i];
+            }
+        }
+        return std::move(array);
     }
 
 
@@ -119,6 +285,158 @@ namespace futilities{
         array.pop_back();
         return std::move(array);
     }
+
+    namespace detail{
+        /**lattices at least this wide are stepped one level at a time in parallel*/
+        constexpr int LATTICE_PARALLEL_WIDTH=1<<15;
+        /**nodes per cache block when narrow lattices are stepped several levels at a time*/
+        constexpr int LATTICE_BLOCK_WIDTH=2048;
+        /**levels per cache block when narrow lattices are stepped several levels at a time*/
+        constexpr int LATTICE_BLOCK_LEVELS=64;
+
+        /**
+            One level of backward induction over nodes [lo, hi), in place.
+            Node i only reads nodes i to i+Taps-1, so walking forward never
+            reads an overwritten node and the loop vectorizes.
+        */
+        template<typename T, typename Kernel>
+        void lattice_level(T* p, int lo, int hi, int step, Kernel& kernel){
+            FUTILITIES_OMP_SIMD
+            for(int i=lo; i<hi; ++i){
+                p[i]=kernel(p+i, i, step);
+            }
+        }
+        /**
+            One level of backward induction split across threads.  Every thread
+            copies the Taps-1 nodes past its chunk before anyone writes so that
+            the update can stay in place.
+        */
+        template<int Taps, typename T, typename Kernel>
+        void lattice_level_parallel(T* p, int newWidth, int step, Kernel& kernel){
+            constexpr int d=Taps-1;
+            #pragma omp parallel
+            {
+                int numThreads=1;
+                int thread=0;
+                #ifdef _OPENMP
+                    numThreads=omp_get_num_threads();
+                    thread=omp_get_thread_num();
+                #endif
+                const int chunk=(newWidth+numThreads-1)/numThreads;
+                const int lo=std::min(thread*chunk, newWidth);
+                const int hi=std::min(lo+chunk, newWidth);
+                const int tailStart=std::max(hi-d, lo);
+                const int numTail=hi-tailStart;
+                T tail[2*d];
+                for(int j=0; j<numTail+d; ++j){
+                    tail[j]=p[tailStart+j];
+                }
+                #pragma omp barrier
+                lattice_level(p, lo, tailStart, step, kernel);
+                for(int j=0; j<numTail; ++j){
+                    p[tailStart+j]=kernel(tail+j, tailStart+j, step);
+                }
+            }
+        }
+        /**
+            Backward induction where every level is Taps-1 nodes narrower than
+            the one before.  Wide levels are split across threads.  Narrow
+            levels are processed LATTICE_BLOCK_LEVELS at a time over skewed
+            blocks so that a block stays in cache for all of its levels: at
+            level s the block [lo, hi) covers [lo-s*(Taps-1), hi-s*(Taps-1)),
+            which only needs nodes that this block or the block to its left
+            already brought to level s.
+            @returns width of the lattice after numSteps levels
+        */
+        template<int Taps, typename T, typename Kernel>
+        int lattice_backward(T* p, int width, int numSteps, Kernel&& kernel){
+            constexpr int d=Taps-1;
+            numSteps=std::min(numSteps, (width-1)/d);
+            int step=0;
+            for(; step<numSteps&&width-d>=LATTICE_PARALLEL_WIDTH; ++step){
+                lattice_level_parallel<Taps>(p, width-d, step, kernel);
+                width-=d;
+            }
+            while(step<numSteps){
+                const int levels=std::min(LATTICE_BLOCK_LEVELS, numSteps-step);
+                bool lastBlock=false;
+                for(int lo=0; !lastBlock; lo+=LATTICE_BLOCK_WIDTH){
+                    lastBlock=lo+LATTICE_BLOCK_WIDTH>=width-d;
+                    for(int s=0; s<levels; ++s){
+                        const int newWidth=width-d*(s+1);
+                        const int from=std::max(lo-d*s, 0);
+                        const int to=lastBlock?newWidth:std::min(lo+LATTICE_BLOCK_WIDTH-d*s, newWidth);
+                        lattice_level(p, from, to, step+s, kernel);
+                    }
+                }
+                width-=d*levels;
+                step+=levels;
+            }
+            return width;
+        }
+    }
+    /**
+        In place backward induction on a binomial lattice.  Equivalent to
+        calling for_each_exclude_last numSteps times but without shrinking
+        the array every step; runs in parallel for wide lattices when compiled
+        with openmp enabled
+        @array std-style contiguous container holding the terminal values
+        @numSteps number of levels to step back
+        @fn function taking (value, next value, index, step) and returning the new value
+        @returns array holding the remaining numSteps-smaller level
+    */
+    template<typename Array, typename Function>
+    auto binomial_backward(Array&& array, int numSteps, Function&& fn){
+        const int width=detail::lattice_backward<2>(array.data(), array.size(), numSteps, [&](const auto* p, int i, int step){
+            return fn(p[0], p[1], i, step);
+        });
+        array.resize(width);
+        return std::move(array);
+    }
+    /**
+        In place backward induction on a binomial lattice with early exercise
+        @array std-style contiguous container holding the terminal values
+        @numSteps number of levels to step back
+        @fn function taking (value, next value, index, step) and returning the continuation value
+        @exercise function taking (index, step) and returning the exercise value
+        @returns array holding the remaining numSteps-smaller level
+    */
+    template<typename Array, typename Function, typename Exercise>
+    auto binomial_backward(Array&& array, int numSteps, Function&& fn, Exercise&& exercise){
+        return binomial_backward(std::move(array), numSteps, [&](const auto& val, const auto& next, int i, int step){
+            return std::max(fn(val, next, i, step), exercise(i, step));
+        });
+    }
+    /**
+        In place backward induction on a trinomial lattice.  Every level is
+        two nodes narrower than the one before.
+        @array std-style contiguous container holding the terminal values
+        @numSteps number of levels to step back
+        @fn function taking (down value, middle value, up value, index, step) and returning the new value
+        @returns array holding the remaining level
+    */
+    template<typename Array, typename Function>
+    auto trinomial_backward(Array&& array, int numSteps, Function&& fn){
+        const int width=detail::lattice_backward<3>(array.data(), array.size(), numSteps, [&](const auto* p, int i, int step){
+            return fn(p[0], p[1], p[2], i, step);
+        });
+        array.resize(width);
+        return std::move(array);
+    }
+    /**
+        In place backward induction on a trinomial lattice with early exercise
+        @array std-style contiguous container holding the terminal values
+        @numSteps number of levels to step back
+        @fn function taking (down value, middle value, up value, index, step) and returning the continuation value
+        @exercise function taking (index, step) and returning the exercise value
+        @returns array holding the remaining level
+    */
+    template<typename Array, typename Function, typename Exercise>
+    auto trinomial_backward(Array&& array, int numSteps, Function&& fn, Exercise&& exercise){
+        return trinomial_backward(std::move(array), numSteps, [&](const auto& down, const auto& mid, const auto& up, int i, int step){
+            return std::max(fn(down, mid, up, i, step), exercise(i, step));
+        });
+    }
     /**
         This function runs in parallel when compiled with openmp enabled
         @array std-style container
@@ -166,16 +484,115 @@ namespace futilities{
    
 
     /**
+        Named functors for the most common lambdas.  sum and for_each 
+        recognise them at compile time and, for contiguous arrays of 
+        float or double, run the vectorized kernels instead of calling 
+        fn(*it, index) one element at a time.  Every functor can be 
+        called as fn(val, index) like a lambda, as fn(val), and with 
+        simd_pack arguments.
+    */
+    namespace ops{
+        /**tag checked by is_op*/
+        struct op{};
+        /**returns the value unchanged*/
+        struct identity: op{
+            template<typename T>
+            T operator()(const T& val) const{
+                return val;
+            }
+            template<typename T, typename Index>
+            T operator()(const T& val, const Index&) const{
+                return val;
+            }
+        };
+        /**returns the square of the value*/
+        struct square: op{
+            template<typename T>
+            T operator()(const T& val) const{
+                return val*val;
+            }
+            template<typename T, typename Index>
+            T operator()(const T& val, const Index&) const{
+                return val*val;
+            }
+        };
+        /**returns the absolute value*/
+        struct abs: op{
+            template<typename T>
+            T operator()(const T& val) const{
+                using std::abs;
+                return abs(val);
+            }
+            template<typename T, typename Index>
+            T operator()(const T& val, const Index&) const{
+                return (*this)(val);
+            }
+        };
+        /**returns the value plus a constant*/
+        template<typename Number>
+        struct plus: op{
+            Number b;
+            explicit plus(const Number& b_):b(b_){}
+            template<typename T>
+            T operator()(const T& val) const{
+                return val+b;
+            }
+            template<typename T, typename Index>
+            T operator()(const T& val, const Index&) const{
+                return val+b;
+            }
+        };
+        /**returns a*val+b*/
+        template<typename Number>
+        struct axpy: op{
+            Number a;
+            Number b;
+            axpy(const Number& a_, const Number& b_):a(a_), b(b_){}
+            template<typename T>
+            T operator()(const T& val) const{
+                return a*val+b;
+            }
+            template<typename T, typename Index>
+            T operator()(const T& val, const Index&) const{
+                return a*val+b;
+            }
+        };
+        template<typename Function>
+        struct is_op: std::is_base_of<op, std::decay_t<Function>>{};
+    }
+    namespace detail{
+        template<typename... T>
+        struct make_void{
+            typedef void type;
+        };
+        template<typename Array, typename=void>
+        struct is_contiguous_floating: std::false_type{};
+        template<typename Array>
+        struct is_contiguous_floating<Array, typename make_void<decltype(std::declval<Array&>().data())>::type>:
+            std::integral_constant<bool, 
+                std::is_floating_point<std::remove_cv_t<std::remove_pointer_t<decltype(std::declval<Array&>().data())>>>::value
+            >{};
+        /**true when fn is one of the ops functors and array is contiguous float or double*/
+        template<typename Array, typename Function>
+        struct use_op_kernel: std::integral_constant<bool, 
+            ops::is_op<Function>::value&&is_contiguous_floating<std::decay_t<Array>>::value
+        >{};
+        /**the loop of for_each; specialised once the kernels are defined*/
+        template<bool UseKernel>
+        struct for_each_route;
+        /**the loop of sum; specialised once the kernels are defined*/
+        template<bool UseKernel>
+        struct sum_route;
+    }
+    /**
+        fn from ops runs the vectorized parallel kernel for float and double arrays
         @array std-style container
         @fn function to apply to every element in the array
         @returns new array with fn applied to original array
     */
     template<typename Array, typename Function>
     auto for_each(Array&& array, Function&& fn){ //reuse array
-        for(auto it = array.begin(); it < array.end(); ++it){
-            *it=fn(*it, it-array.begin());   
-        }
-        return std::move(array);
+        return detail::for_each_route<detail::use_op_kernel<Array, Function>::value>::apply(std::move(array), fn);
     }
     /**
     Careful!  this function provides a mutated array (not the original array)
@@ -203,6 +620,60 @@ namespace futilities{
         }
         return std::move(tmpArr);
     }
+    /**
+        Parallel version of repeatedly calling for_each_copy.  Two buffers are
+        allocated once and swapped after every sweep.  This function runs in
+        parallel when compiled with openmp enabled
+        @array std-style container holding the initial iterate
+        @numSweeps maximum number of sweeps
+        @fn function taking (value, index, previous iterate) and returning the new value
+        @returns array after numSweeps sweeps
+    */
+    template<typename Array, typename Function>
+    auto jacobi_parallel(Array&& array, int numSweeps, Function&& fn){
+        std::decay_t<Array> next=array;
+        const int n=array.size();
+        for(int sweep=0; sweep<numSweeps; ++sweep){
+            const Array& prev=array;
+            #pragma omp parallel for
+            for(int i=0; i<n; ++i){
+                next[i]=fn(prev[i], i, prev);
+            }
+            std::swap(array, next);
+        }
+        return std::move(array);
+    }
+    /**
+        Parallel Jacobi iteration with a residual fused into every sweep.
+        The residual of a sweep is the sum of residualFn(new, old) over every
+        element and is computed in the same pass that writes the new iterate.
+        This function runs in parallel when compiled with openmp enabled
+        @array std-style container holding the initial iterate
+        @numSweeps maximum number of sweeps
+        @fn function taking (value, index, previous iterate) and returning the new value
+        @residualFn function taking (new value, old value) and returning an arithmetic contribution to the residual
+        @kpg function taking the residual of the latest sweep and returning false when converged
+        @returns array after convergence or numSweeps sweeps
+    */
+    template<typename Array, typename Function, typename Residual, typename keepGoing>
+    auto jacobi_parallel(Array&& array, int numSweeps, Function&& fn, Residual&& residualFn, keepGoing&& kpg){
+        std::decay_t<Array> next=array;
+        const int n=array.size();
+        for(int sweep=0; sweep<numSweeps; ++sweep){
+            const Array& prev=array;
+            std::decay_t<decltype(residualFn(prev[0], prev[0]))> residual=0;
+            #pragma omp parallel for reduction(+:residual)
+            for(int i=0; i<n; ++i){
+                next[i]=fn(prev[i], i, prev);
+                residual+=residualFn(next[i], prev[i]);
+            }
+            std::swap(array, next);
+            if(!kpg(residual)){
+                break;
+            }
+        }
+        return std::move(array);
+    }
 
     template<typename incr, typename fnToApply>
     auto for_each(incr begin, incr end, fnToApply&& fn)->std::vector<decltype(fn(begin))>{
@@ -214,6 +685,809 @@ namespace futilities{
         }
         return myVector;
     }
+
+    /**Number of lanes in a simd_pack by default: one 256 bit register*/
+    template<typename T>
+    struct simd_width{
+        static constexpr int value=sizeof(T)>=32?1:32/sizeof(T);
+    };
+    /**
+        Fixed width pack of lanes passed to the lambdas of for_each_simd.  
+        With gcc and clang the lanes are a vector extension type so 
+        arithmetic maps straight onto vector instructions; otherwise every 
+        operation is a loop over the lanes.  Scalars broadcast to every 
+        lane so lambdas like [](const auto& v){return 2.0*v+1.0;} work 
+        for both packs and the scalar tail.
+    */
+    template<typename T, int W=simd_width<T>::value>
+    struct simd_pack{
+        typedef T value_type;
+        static constexpr int width=W;
+        #ifdef __GNUC__
+            typedef T storage_type __attribute__((vector_size(W*sizeof(T))));
+        #else
+            struct alignas(W*sizeof(T)) storage_type{
+                T lane[W];
+            };
+        #endif
+        storage_type lanes;
+
+        simd_pack()=default;
+        simd_pack(const T& scalar){
+            for(int i=0; i<W; ++i){
+                data()[i]=scalar;
+            }
+        }
+        static simd_pack from_storage(const storage_type& other){
+            simd_pack result;
+            result.lanes=other;
+            return result;
+        }
+        template<typename U>
+        explicit simd_pack(const simd_pack<U, W>& other){
+            for(int i=0; i<W; ++i){
+                data()[i]=static_cast<T>(other[i]);
+            }
+        }
+        static simd_pack load(const T* source){
+            simd_pack result;
+            std::memcpy(&result.lanes, source, sizeof(storage_type));
+            return result;
+        }
+        static simd_pack load_aligned(const T* source){
+            #ifdef __GNUC__
+                source=static_cast<const T*>(__builtin_assume_aligned(source, alignof(storage_type)));
+            #endif
+            return load(source);
+        }
+        void store(T* destination) const{
+            std::memcpy(destination, &lanes, sizeof(storage_type));
+        }
+        void store_aligned(T* destination) const{
+            #ifdef __GNUC__
+                destination=static_cast<T*>(__builtin_assume_aligned(destination, alignof(storage_type)));
+            #endif
+            store(destination);
+        }
+        T* data(){
+            return reinterpret_cast<T*>(&lanes);
+        }
+        const T* data() const{
+            return reinterpret_cast<const T*>(&lanes);
+        }
+        T& operator[](int i){
+            return data()[i];
+        }
+        const T& operator[](int i) const{
+            return data()[i];
+        }
+        /**applies fn to every lane*/
+        template<typename Function>
+        simd_pack map(Function&& fn) const{
+            simd_pack result;
+            for(int i=0; i<W; ++i){
+                result[i]=fn((*this)[i]);
+            }
+            return result;
+        }
+        /**applies fn to matching lanes of two packs*/
+        template<typename Function>
+        simd_pack zip(const simd_pack& other, Function&& fn) const{
+            simd_pack result;
+            for(int i=0; i<W; ++i){
+                result[i]=fn((*this)[i], other[i]);
+            }
+            return result;
+        }
+
+        #ifdef __GNUC__
+            friend simd_pack operator+(const simd_pack& a, const simd_pack& b){
+                return from_storage(a.lanes+b.lanes);
+            }
+            friend simd_pack operator-(const simd_pack& a, const simd_pack& b){
+                return from_storage(a.lanes-b.lanes);
+            }
+            friend simd_pack operator*(const simd_pack& a, const simd_pack& b){
+                return from_storage(a.lanes*b.lanes);
+            }
+            friend simd_pack operator/(const simd_pack& a, const simd_pack& b){
+                return from_storage(a.lanes/b.lanes);
+            }
+            friend simd_pack operator-(const simd_pack& a){
+                return from_storage(-a.lanes);
+            }
+        #else
+            friend simd_pack operator+(const simd_pack& a, const simd_pack& b){
+                return a.zip(b, [](const T& x, const T& y){return x+y;});
+            }
+            friend simd_pack operator-(const simd_pack& a, const simd_pack& b){
+                return a.zip(b, [](const T& x, const T& y){return x-y;});
+            }
+            friend simd_pack operator*(const simd_pack& a, const simd_pack& b){
+                return a.zip(b, [](const T& x, const T& y){return x*y;});
+            }
+            friend simd_pack operator/(const simd_pack& a, const simd_pack& b){
+                return a.zip(b, [](const T& x, const T& y){return x/y;});
+            }
+            friend simd_pack operator-(const simd_pack& a){
+                return a.map([](const T& x){return -x;});
+            }
+        #endif
+        simd_pack& operator+=(const simd_pack& b){
+            return *this=*this+b;
+        }
+        simd_pack& operator-=(const simd_pack& b){
+            return *this=*this-b;
+        }
+        simd_pack& operator*=(const simd_pack& b){
+            return *this=*this*b;
+        }
+        simd_pack& operator/=(const simd_pack& b){
+            return *this=*this/b;
+        }
+        friend simd_pack min(const simd_pack& a, const simd_pack& b){
+            return a.zip(b, [](const T& x, const T& y){return y<x?y:x;});
+        }
+        friend simd_pack max(const simd_pack& a, const simd_pack& b){
+            return a.zip(b, [](const T& x, const T& y){return x<y?y:x;});
+        }
+        friend simd_pack abs(const simd_pack& a){
+            return a.map([](const T& x){return x<T(0)?-x:x;});
+        }
+        friend simd_pack sqrt(const simd_pack& a){
+            return a.map([](const T& x){return std::sqrt(x);});
+        }
+        /**sum of the lanes*/
+        friend T horizontal_sum(const simd_pack& a){
+            T result=a[0];
+            for(int i=1; i<W; ++i){
+                result+=a[i];
+            }
+            return result;
+        }
+    };
+    namespace detail{
+        /**
+            Applies fn to [begin, end) of data.  When the data can be 
+            aligned, elements are handled one at a time until it is and 
+            then a pack at a time with aligned loads.  Elements that do 
+            not fill a pack are handled one at a time.  fn receives 
+            (value, index) for both packs and scalars.
+        */
+        template<typename T, typename Function>
+        void for_each_simd_range(T* data, int begin, int end, Function&& fn){
+            typedef simd_pack<T> pack;
+            constexpr int W=pack::width;
+            int i=begin;
+            const std::uintptr_t offset=reinterpret_cast<std::uintptr_t>(data+begin)%alignof(typename pack::storage_type);
+            if(offset%sizeof(T)==0){
+                const int peelEnd=std::min(end, begin+(int)(((alignof(typename pack::storage_type)-offset)%alignof(typename pack::storage_type))/sizeof(T)));
+                for(; i<peelEnd; ++i){
+                    data[i]=fn(data[i], i);
+                }
+                for(; i+W<=end; i+=W){
+                    pack(fn(pack::load_aligned(data+i), i)).store_aligned(data+i);
+                }
+            }
+            else{
+                for(; i+W<=end; i+=W){
+                    pack(fn(pack::load(data+i), i)).store(data+i);
+                }
+            }
+            for(; i<end; ++i){
+                data[i]=fn(data[i], i);
+            }
+        }
+        /**indices of the lanes of a pack starting at i, as ints like the scalar index so that every index is exact*/
+        template<typename T, int W>
+        simd_pack<int, W> lane_index(const simd_pack<T, W>&, int i){
+            simd_pack<int, W> result;
+            for(int j=0; j<W; ++j){
+                result[j]=i+j;
+            }
+            return result;
+        }
+        /**index of a scalar*/
+        template<typename T>
+        int lane_index(const T&, int i){
+            return i;
+        }
+    }
+    /**
+        Like for_each, but fn is called with a simd_pack of consecutive 
+        elements and a scalar only for the elements that do not fill a 
+        pack.  fn must work for both, eg [](const auto& v){return v*v;}
+        @array std-style contiguous container
+        @fn function taking a pack or a scalar and returning the same
+        @returns new array with fn applied to original array
+    */
+    template<typename Array, typename Function>
+    auto for_each_simd(Array&& array, Function&& fn){
+        detail::for_each_simd_range(array.data(), 0, array.size(), [&](const auto& val, int){
+            return fn(val);
+        });
+        return std::move(array);
+    }
+    /**
+        Like for_each_simd, but fn also receives the index of every lane: 
+        a simd_pack of int for packs and an int for the scalar tail.  
+        std::decay_t<decltype(val)>(index) converts either to the type 
+        of the values, eg for val*index with float and double
+        @array std-style contiguous container
+        @fn function taking (value, index) as packs or as scalars
+        @returns new array with fn applied to original array
+    */
+    template<typename Array, typename Function>
+    auto for_each_simd_index(Array&& array, Function&& fn){
+        detail::for_each_simd_range(array.data(), 0, array.size(), [&](const auto& val, int i){
+            return fn(val, detail::lane_index(val, i));
+        });
+        return std::move(array);
+    }
+    /**
+        Parallel version of for_each_simd.  This function runs in parallel
+        when compiled with openmp enabled
+        @array std-style contiguous container
+        @fn function taking a pack or a scalar and returning the same
+        @returns new array with fn applied to original array
+    */
+    template<typename Array, typename Function>
+    auto for_each_parallel_simd(Array&& array, Function&& fn){
+        constexpr int blockSize=4096;
+        const int n=array.size();
+        auto* data=array.data();
+        #pragma omp parallel for
+        for(int block=0; block<n; block+=blockSize){
+            detail::for_each_simd_range(data, block, std::min(block+blockSize, n), [&](const auto& val, int){
+                return fn(val);
+            });
+        }
+        return std::move(array);
+    }
+    
+    /**
+        Transcendental functions written without branches or calls, unlike 
+        libm.  Every function takes a float, a double, or a simd_pack of 
+        either, and an optional accuracy tier:  math::exp(x) is precise and 
+        math::exp<math::fast>(x) trades accuracy for speed.  With gcc and 
+        clang the pack versions run the same code on whole vector 
+        registers, so lambdas like [](const auto& v){return math::exp(v);} 
+        passed to for_each_simd are vectorized end to end.  The precise exp, 
+        log and erf need about four lanes per register to beat libm, and 
+        double erf eight, so scalars and packs with fewer, eg double 
+        without avx, use libm.
+    */
+    namespace math{
+        /**
+            Within a few ulp of libm for double and float: exp and log 1 
+            ulp, erf 4 ulp, and sin, cos and sincos 1 ulp for |x|<=100 
+            and 2 ulp up to the reduction limit.  sin and cos reduce the 
+            argument in registers for |x|<=2^21 (double) and |x|<=2^13 
+            (float); larger or non-finite arguments fall back to std::sin 
+            and std::cos lane by lane, which keeps them accurate at scalar 
+            speed.  exp, log and erf of scalars, and of packs of fewer 
+            than four lanes per register (eight for double erf), are 
+            libm's.
+        */
+        struct precise{};
+        /**
+            Relative error below about 2e-8 for double (1e-6 for erf) 
+            and about 1e-6 for float, with shorter polynomials.
+        */
+        struct fast{};
+
+        namespace detail{
+            template<typename T>
+            struct float_traits;
+            template<>
+            struct float_traits<double>{
+                typedef std::uint64_t int_type;
+                static constexpr int mantissa_bits=52;
+                static constexpr int_type bias=1023;
+                /**1.5*2^52: adding it rounds to an integer held in the low bits*/
+                static constexpr double round_magic=6755399441055744.0;
+                static constexpr double min_normal=2.2250738585072014e-308;
+                static constexpr double exp_min=-745.2;
+                static constexpr double exp_max=709.78;
+                static constexpr double ln2_hi=6.93147180369123816490e-01;
+                static constexpr double ln2_lo=1.90821492927058770002e-10;
+                static constexpr double pio2_1=1.57079632673412561417e+00;
+                static constexpr double pio2_2=6.07710050630396597660e-11;
+                static constexpr double pio2_3=2.02226624871116645580e-21;
+                /**largest |x| that the three part pi/2 reduces to about 2 ulp*/
+                static constexpr double reduction_limit=2097152.0;
+            };
+            template<>
+            struct float_traits<float>{
+                typedef std::uint32_t int_type;
+                static constexpr int mantissa_bits=23;
+                static constexpr int_type bias=127;
+                static constexpr float round_magic=12582912.0f;
+                static constexpr float min_normal=1.17549435e-38f;
+                static constexpr float exp_min=-103.9f;
+                static constexpr float exp_max=88.72f;
+                static constexpr float ln2_hi=0.693145751953125f;
+                static constexpr float ln2_lo=1.428606765330187045e-06f;
+                static constexpr float pio2_1=1.5703125f;
+                static constexpr float pio2_2=4.837512969970703125e-4f;
+                static constexpr float pio2_3=7.54978995489188216e-8f;
+                static constexpr float reduction_limit=8192.0f;
+            };
+            /**
+                Element and integer types of V, which is either a float or 
+                double or a gcc vector of them.  Vectors compare to masks 
+                and select with ?: lane by lane, so one implementation 
+                serves both.  The integers are unsigned so that the bit 
+                manipulation wraps instead of overflowing and shifts are 
+                logical, which every vector unit has.
+            */
+            template<typename V, bool Scalar=std::is_arithmetic<V>::value>
+            struct lanes{
+                typedef V scalar;
+                typedef typename float_traits<V>::int_type int_type;
+            };
+            #ifdef __GNUC__
+                template<typename V>
+                struct lanes<V, false>{
+                    typedef std::decay_t<decltype(std::declval<V>()[0])> scalar;
+                    typedef typename float_traits<scalar>::int_type int_type __attribute__((vector_size(sizeof(V))));
+                };
+            #endif
+            /**number of terms in each series per type and tier*/
+            template<typename T, typename Tier>
+            struct terms;
+            template<>
+            struct terms<double, precise>{
+                static constexpr int exp=14, log=10, sin=8, cos=8, erf=13, erfc=28;
+            };
+            template<>
+            struct terms<double, fast>{
+                static constexpr int exp=8, log=4, sin=4, cos=5, erf=6;
+            };
+            template<>
+            struct terms<float, precise>{
+                static constexpr int exp=8, log=4, sin=4, cos=5, erf=7, erfc=14;
+            };
+            template<>
+            struct terms<float, fast>{
+                static constexpr int exp=7, log=3, sin=3, cos=4, erf=5;
+            };
+
+            /**every lane set to value*/
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE V broadcast(typename lanes<V>::scalar value){
+                return V{}+value;
+            }
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE typename lanes<V>::int_type to_bits(const V& x){
+                typename lanes<V>::int_type result;
+                std::memcpy(&result, &x, sizeof(V));
+                return result;
+            }
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE V from_bits(const typename lanes<V>::int_type& bits){
+                V result;
+                std::memcpy(&result, &bits, sizeof(V));
+                return result;
+            }
+            /**k, already a whole number, as an integer modulo 2^bits, for |k|<2^(mantissa_bits-1)*/
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE typename lanes<V>::int_type to_int(const V& k){
+                typedef typename lanes<V>::scalar T;
+                const T magic=float_traits<T>::round_magic;
+                return to_bits(V(k+magic))-to_bits(magic);
+            }
+            /**integer to floating point without conversion instructions some vector units lack*/
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE V to_float(const typename lanes<V>::int_type& k){
+                typedef typename lanes<V>::scalar T;
+                const T magic=float_traits<T>::round_magic;
+                return from_bits<V>(k+to_bits(magic))-magic;
+            }
+            /**2^k for k in the normal exponent range*/
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE V pow2(const typename lanes<V>::int_type& k){
+                typedef float_traits<typename lanes<V>::scalar> traits;
+                return from_bits<V>((k+traits::bias)<<traits::mantissa_bits);
+            }
+
+            template<int N>
+            struct inv_factorial{
+                static constexpr double value=inv_factorial<N-1>::value/N;
+            };
+            template<>
+            struct inv_factorial<0>{
+                static constexpr double value=1;
+            };
+            /**
+                Sum of Coefficient<j>::value*x^j for j<N by Horner's rule, 
+                unrolled at compile time so the coefficients are constants
+            */
+            template<template<int> class Coefficient, int N, int J=0>
+            struct series{
+                template<typename V>
+                static FUTILITIES_ALWAYS_INLINE V apply(const V& x){
+                    return apply(x, std::integral_constant<bool, (J+1<N)>());
+                }
+                template<typename V>
+                static FUTILITIES_ALWAYS_INLINE V apply(const V&, std::false_type){
+                    typedef typename lanes<V>::scalar T;
+                    return broadcast<V>(T(Coefficient<J>::value));
+                }
+                template<typename V>
+                static FUTILITIES_ALWAYS_INLINE V apply(const V& x, std::true_type){
+                    typedef typename lanes<V>::scalar T;
+                    return x*series<Coefficient, N, J+1>::apply(x)+T(Coefficient<J>::value);
+                }
+            };
+            /**1/j!, for exp*/
+            template<int J>
+            struct exp_coefficient{
+                static constexpr double value=inv_factorial<J>::value;
+            };
+            /**(-1)^(j+1)/(2j+3)!, for (sin(r)/r-1)/r^2 in r^2*/
+            template<int J>
+            struct sin_coefficient{
+                static constexpr double value=(J%2==0?-1:1)*inv_factorial<2*J+3>::value;
+            };
+            /**(-1)^(j+1)/(2j+2)!, for (cos(r)-1)/r^2 in r^2*/
+            template<int J>
+            struct cos_coefficient{
+                static constexpr double value=(J%2==0?-1:1)*inv_factorial<2*J+2>::value;
+            };
+            /**1/(2j+3), for (atanh(s)/s-1)/s^2 in s^2*/
+            template<int J>
+            struct atanh_coefficient{
+                static constexpr double value=1.0/(2*J+3);
+            };
+            /**(-1)^j/(j!(2j+1)), for erf(z)*sqrt(pi)/(2z) in z^2*/
+            template<int J>
+            struct erf_coefficient{
+                static constexpr double value=(J%2==0?1:-1)*inv_factorial<J>::value/(2*J+1);
+            };
+            /**
+                Chebyshev coefficients in u=2t-1, t=2/(2+z), of 
+                log(erfc(z)exp(z^2)/t), which is smooth on all of z>=0.  
+                Fitted in long double at Chebyshev nodes.
+            */
+            constexpr double ERF_CHEBYSHEV[28]={
+                -6.513268598908547170161e-01, 6.419697923564902601991e-01, 1.947647320418583627290e-02, 
+                -9.561514786808631501287e-03, -9.465953444820368893522e-04, 3.668394978527615875372e-04, 
+                4.252332480690753854780e-05, -2.027857811253425536317e-05, -1.624290004647357390677e-06, 
+                1.303655835580935741166e-06, 1.562644172225634980824e-08, -8.523809591512400071896e-08, 
+                6.529054439544795807119e-09, 5.059343495485060099465e-09, -9.913641564618120432881e-10, 
+                -2.273651222210824190911e-10, 9.646791070496742170766e-11, 2.394038309608270687079e-12, 
+                -6.886028330660085017436e-12, 8.944885441066266484889e-13, 3.130920273475973347743e-13, 
+                -1.127085783644149463687e-13, 3.822598704586455120687e-16, 7.104931335107089740510e-15, 
+                -1.522745688223303694958e-15, -9.498424182602382970351e-17, 1.205144924826262453669e-16, 
+                -2.726768463801043651529e-17
+            };
+            /**sum of ERF_CHEBYSHEV[k]*T_k(u) for k<=K by Clenshaw's recurrence*/
+            template<int K>
+            struct erf_clenshaw{
+                template<typename V>
+                static FUTILITIES_ALWAYS_INLINE V apply(const V& u, const V& b1, const V& b2){
+                    typedef typename lanes<V>::scalar T;
+                    return erf_clenshaw<K-1>::apply(u, T(2)*u*b1-b2+T(ERF_CHEBYSHEV[K]), b1);
+                }
+            };
+            template<>
+            struct erf_clenshaw<0>{
+                template<typename V>
+                static FUTILITIES_ALWAYS_INLINE V apply(const V& u, const V& b1, const V& b2){
+                    typedef typename lanes<V>::scalar T;
+                    return u*b1-b2+T(ERF_CHEBYSHEV[0]);
+                }
+            };
+
+            template<typename Tier, typename V>
+            FUTILITIES_ALWAYS_INLINE V exp(const V& x){
+                typedef typename lanes<V>::scalar T;
+                typedef float_traits<T> traits;
+                const V lower=broadcast<V>(traits::exp_min);
+                const V upper=broadcast<V>(traits::exp_max);
+                const V clamped=x<lower?lower:(x>upper?upper:x);
+                const V k=(clamped*T(1.44269504088896340736)+traits::round_magic)-traits::round_magic;
+                const V r=(clamped-k*traits::ln2_hi)-k*traits::ln2_lo;
+                //two factors so that results near the overflow and underflow limits stay exact
+                const V half=(k*T(0.5)+traits::round_magic)-traits::round_magic;
+                const V result=series<exp_coefficient, terms<T, Tier>::exp>::apply(r)*pow2<V>(to_int(half))*pow2<V>(to_int(V(k-half)));
+                return x>upper?broadcast<V>(HUGE_VAL):(x<lower?V{}:result);
+            }
+            template<typename Tier, typename V>
+            FUTILITIES_ALWAYS_INLINE V log(const V& x){
+                typedef typename lanes<V>::scalar T;
+                typedef float_traits<T> traits;
+                typedef typename lanes<V>::int_type int_type;
+                typedef typename traits::int_type int_scalar;
+                constexpr int_scalar mantissaMask=(int_scalar(1)<<traits::mantissa_bits)-1;
+                constexpr int_scalar subnormalShift=traits::mantissa_bits+2;
+                const auto subnormal=x<traits::min_normal;
+                //scale subnormals into the normal range
+                const V scaled=subnormal?x*T(int_scalar(1)<<subnormalShift):x;
+                const int_type bits=to_bits(scaled);
+                const V mantissa=from_bits<V>((bits&mantissaMask)|(traits::bias<<traits::mantissa_bits));
+                const auto high=mantissa>T(1.41421356237309504880);
+                const int_type adjust=(high?int_type{}+int_scalar(1):int_type{})-(subnormal?int_type{}+subnormalShift:int_type{});
+                const V m=high?mantissa*T(0.5):mantissa;
+                const V f=m-T(1);
+                const V s=f/(T(2)+f);
+                const V e=to_float<V>((bits>>traits::mantissa_bits)-traits::bias+adjust);
+                //log(m)=2atanh(s)=f-s(f-r), which keeps f exact and only rounds the small correction
+                const V s2=s*s;
+                const V r=T(2)*s2*series<atanh_coefficient, terms<T, Tier>::log>::apply(s2);
+                const V result=e*traits::ln2_hi+(f-(s*(f-r)-e*traits::ln2_lo));
+                return ((x<T(0))|(x!=x))?broadcast<V>(NAN):(x==T(0)?broadcast<V>(-HUGE_VAL):(x==T(HUGE_VAL)?x:result));
+            }
+            /**whether every lane of x is within reduction_limit, from one vector comparison*/
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE bool within_reduction(const V& x){
+                typedef typename lanes<V>::scalar T;
+                const auto inRange=(x<T(0)?-x:x)<=float_traits<T>::reduction_limit;
+                std::uint64_t words[sizeof(V)/sizeof(std::uint64_t)];
+                std::memcpy(words, &inRange, sizeof(words));
+                std::uint64_t all=~std::uint64_t(0);
+                for(auto word:words){
+                    all&=word;
+                }
+                return all==~std::uint64_t(0);
+            }
+            /**
+                sin and cos of x after reducing by multiples of pi/2 with 
+                a three part pi/2, accurate for |x|<=reduction_limit
+            */
+            template<typename Tier, typename V>
+            FUTILITIES_ALWAYS_INLINE std::pair<V, V> sincos(const V& x){
+                typedef typename lanes<V>::scalar T;
+                typedef float_traits<T> traits;
+                typedef terms<T, Tier> n;
+                const V k=(x*T(0.636619772367581343076)+traits::round_magic)-traits::round_magic;
+                const V r=((x-k*traits::pio2_1)-k*traits::pio2_2)-k*traits::pio2_3;
+                const V r2=r*r;
+                const V sinR=r+r*r2*series<sin_coefficient, n::sin>::apply(r2);
+                const V cosR=T(1)+r2*series<cos_coefficient, n::cos>::apply(r2);
+                //compared as floating point, since not every vector unit compares 64 bit integers
+                const V quadrant=to_float<V>(to_int(k)&3);
+                return std::pair<V, V>(
+                    quadrant==T(0)?sinR:(quadrant==T(1)?cosR:(quadrant==T(2)?-sinR:-cosR)),
+                    quadrant==T(0)?cosR:(quadrant==T(1)?-sinR:(quadrant==T(2)?-cosR:sinR))
+                );
+            }
+            /**sincos for scalars, from libm beyond reduction_limit and for non-finite x*/
+            template<typename Tier, typename T>
+            FUTILITIES_ALWAYS_INLINE std::pair<T, T> sincos_scalar(const T& x){
+                return std::abs(x)<=float_traits<T>::reduction_limit?sincos<Tier>(x):std::pair<T, T>(std::sin(x), std::cos(x));
+            }
+            /**erfc(z) for z>=0.5 by Abramowitz and Stegun 7.1.26*/
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE V erf_complement(const V& z, const V& z2, fast){
+                typedef typename lanes<V>::scalar T;
+                const V t=T(1)/(T(1)+T(0.3275911)*z);
+                const V p=t*(T(0.254829592)+t*(T(-0.284496736)+t*(T(1.421413741)+t*(T(-1.453152027)+t*T(1.061405429)))));
+                return p*exp<fast>(V(-z2));
+            }
+            /**erfc(z) for z>=0.5 as t*exp(-z^2+f(t)) with f the Chebyshev fit in t=2/(2+z)*/
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE V erf_complement(const V& z, const V& z2, precise){
+                typedef typename lanes<V>::scalar T;
+                const V t=T(2)/(T(2)+z);
+                const V f=erf_clenshaw<terms<T, precise>::erfc-1>::apply(V(T(2)*t-T(1)), V{}, V{});
+                return t*exp<precise>(V(f-z2));
+            }
+            /**Taylor series below 0.5 and one minus erfc above*/
+            template<typename Tier, typename V>
+            FUTILITIES_ALWAYS_INLINE V erf(const V& x){
+                typedef typename lanes<V>::scalar T;
+                const V z=x<T(0)?-x:x;
+                const V z2=z*z;
+                const V small=T(1.12837916709551257390)*z*series<erf_coefficient, terms<T, Tier>::erf>::apply(z2);
+                const V result=z<T(0.5)?small:T(1)-erf_complement(z, z2, Tier());
+                return x<T(0)?-result:result;
+            }
+            /**the kernels, for the fast tier and gcc vectors*/
+            template<typename Tier, typename T, bool Libm=std::is_same<Tier, precise>::value&&std::is_floating_point<T>::value>
+            struct scalar_math{
+                static FUTILITIES_ALWAYS_INLINE T exp(const T& x){
+                    return detail::exp<Tier>(x);
+                }
+                static FUTILITIES_ALWAYS_INLINE T log(const T& x){
+                    return detail::log<Tier>(x);
+                }
+                static FUTILITIES_ALWAYS_INLINE T erf(const T& x){
+                    return detail::erf<Tier>(x);
+                }
+            };
+            /**libm, for precise scalars, which it matches and outruns one lane at a time*/
+            template<typename Tier, typename T>
+            struct scalar_math<Tier, T, true>{
+                static FUTILITIES_ALWAYS_INLINE T exp(const T& x){
+                    return std::exp(x);
+                }
+                static FUTILITIES_ALWAYS_INLINE T log(const T& x){
+                    return std::log(x);
+                }
+                static FUTILITIES_ALWAYS_INLINE T erf(const T& x){
+                    return std::erf(x);
+                }
+            };
+        }
+
+        /**
+            @x argument
+            @returns e^x; below about -745 (-104 for float) returns zero
+        */
+        template<typename Tier=precise, typename T>
+        FUTILITIES_ALWAYS_INLINE T exp(const T& x){
+            return detail::scalar_math<Tier, T>::exp(x);
+        }
+        /**
+            @x argument
+            @returns natural logarithm of x
+        */
+        template<typename Tier=precise, typename T>
+        FUTILITIES_ALWAYS_INLINE T log(const T& x){
+            return detail::scalar_math<Tier, T>::log(x);
+        }
+        /**
+            @x argument
+            @returns pair of sin(x) and cos(x), for the cost of about one of them
+        */
+        template<typename Tier=precise, typename T>
+        FUTILITIES_ALWAYS_INLINE std::pair<T, T> sincos(const T& x){
+            return detail::sincos_scalar<Tier>(x);
+        }
+        /**
+            @x argument
+            @returns sin(x)
+        */
+        template<typename Tier=precise, typename T>
+        FUTILITIES_ALWAYS_INLINE T sin(const T& x){
+            return detail::sincos_scalar<Tier>(x).first;
+        }
+        /**
+            @x argument
+            @returns cos(x)
+        */
+        template<typename Tier=precise, typename T>
+        FUTILITIES_ALWAYS_INLINE T cos(const T& x){
+            return detail::sincos_scalar<Tier>(x).second;
+        }
+        /**
+            On packs the precise tier's erfc uses a Chebyshev fit covering 
+            all of |x|>=0.5; the fast tier uses Abramowitz and Stegun 7.1.26.
+            @x argument
+            @returns error function of x
+        */
+        template<typename Tier=precise, typename T>
+        FUTILITIES_ALWAYS_INLINE T erf(const T& x){
+            return detail::scalar_math<Tier, T>::erf(x);
+        }
+
+        #ifdef __GNUC__
+            namespace detail{
+                #if defined(__AVX512F__)
+                    constexpr int NATIVE_VECTOR_BYTES=64;
+                #elif defined(__AVX__)
+                    constexpr int NATIVE_VECTOR_BYTES=32;
+                #else
+                    constexpr int NATIVE_VECTOR_BYTES=16;
+                #endif
+                /**widest vector the target compiles to, and no wider than W lanes*/
+                template<typename T, int W>
+                struct native_register{
+                    static constexpr int bytes=W*(int)sizeof(T)<NATIVE_VECTOR_BYTES?W*(int)sizeof(T):NATIVE_VECTOR_BYTES;
+                    static constexpr int width=bytes/sizeof(T);
+                    typedef T type __attribute__((vector_size(bytes)));
+                };
+                /**
+                    Calls fn on each native register of x.  gcc splits 
+                    comparisons and selects on vectors wider than the 
+                    target's registers into scalar branches, so packs are 
+                    handled a register at a time.
+                */
+                template<typename T, int W, typename Function>
+                FUTILITIES_ALWAYS_INLINE void for_each_register(const simd_pack<T, W>& x, Function&& fn){
+                    typedef native_register<T, W> reg;
+                    for(int i=0; i<W; i+=reg::width){
+                        typename reg::type v;
+                        std::memcpy(&v, x.data()+i, sizeof(v));
+                        fn(v, i);
+                    }
+                }
+                /**
+                    Whether the precise exp, log and erf of a pack go to 
+                    libm, since with fewer than Lanes lanes per register 
+                    the kernels are slower
+                */
+                template<typename Tier, typename T, int W, int Lanes=4>
+                struct prefer_libm:std::integral_constant<bool, std::is_same<Tier, precise>::value&&(native_register<T, W>::width<Lanes)>{};
+                template<typename T, int W, typename Function>
+                FUTILITIES_ALWAYS_INLINE simd_pack<T, W> map_registers(const simd_pack<T, W>& x, Function&& fn){
+                    simd_pack<T, W> result;
+                    for_each_register(x, [&](const auto& v, int i){
+                        const auto mapped=fn(v);
+                        std::memcpy(result.data()+i, &mapped, sizeof(mapped));
+                    });
+                    return result;
+                }
+            }
+            /**exp of every lane*/
+            template<typename Tier=precise, typename T, int W>
+            simd_pack<T, W> exp(const simd_pack<T, W>& x){
+                if(detail::prefer_libm<Tier, T, W>::value){
+                    return x.map([](const T& val){return std::exp(val);});
+                }
+                return detail::map_registers(x, [](const auto& v){return detail::exp<Tier>(v);});
+            }
+            /**log of every lane*/
+            template<typename Tier=precise, typename T, int W>
+            simd_pack<T, W> log(const simd_pack<T, W>& x){
+                if(detail::prefer_libm<Tier, T, W>::value){
+                    return x.map([](const T& val){return std::log(val);});
+                }
+                return detail::map_registers(x, [](const auto& v){return detail::log<Tier>(v);});
+            }
+            /**sin and cos of every lane, from libm for lanes beyond the reduction limit*/
+            template<typename Tier=precise, typename T, int W>
+            std::pair<simd_pack<T, W>, simd_pack<T, W>> sincos(const simd_pack<T, W>& x){
+                std::pair<simd_pack<T, W>, simd_pack<T, W>> result;
+                bool inRange=true;
+                detail::for_each_register(x, [&](const auto& v, int i){
+                    const auto sinCos=detail::sincos<Tier>(v);
+                    std::memcpy(result.first.data()+i, &sinCos.first, sizeof(v));
+                    std::memcpy(result.second.data()+i, &sinCos.second, sizeof(v));
+                    inRange&=detail::within_reduction(v);
+                });
+                if(!inRange){
+                    for(int i=0; i<W; ++i){
+                        const auto sinCos=detail::sincos_scalar<Tier>(x[i]);
+                        result.first[i]=sinCos.first;
+                        result.second[i]=sinCos.second;
+                    }
+                }
+                return result;
+            }
+            /**erf of every lane*/
+            template<typename Tier=precise, typename T, int W>
+            simd_pack<T, W> erf(const simd_pack<T, W>& x){
+                //the erfc fit of double is twice as long, and pays off from eight lanes
+                if(detail::prefer_libm<Tier, T, W, sizeof(T)==sizeof(double)?8:4>::value){
+                    return x.map([](const T& val){return std::erf(val);});
+                }
+                return detail::map_registers(x, [](const auto& v){return detail::erf<Tier>(v);});
+            }
+        #else
+            template<typename Tier=precise, typename T, int W>
+            simd_pack<T, W> exp(const simd_pack<T, W>& x){
+                return x.map([](const T& val){return detail::scalar_math<Tier, T>::exp(val);});
+            }
+            template<typename Tier=precise, typename T, int W>
+            simd_pack<T, W> log(const simd_pack<T, W>& x){
+                return x.map([](const T& val){return detail::scalar_math<Tier, T>::log(val);});
+            }
+            template<typename Tier=precise, typename T, int W>
+            std::pair<simd_pack<T, W>, simd_pack<T, W>> sincos(const simd_pack<T, W>& x){
+                return std::make_pair(
+                    x.map([](const T& val){return detail::sincos_scalar<Tier>(val).first;}),
+                    x.map([](const T& val){return detail::sincos_scalar<Tier>(val).second;})
+                );
+            }
+            template<typename Tier=precise, typename T, int W>
+            simd_pack<T, W> erf(const simd_pack<T, W>& x){
+                return x.map([](const T& val){return detail::scalar_math<Tier, T>::erf(val);});
+            }
+        #endif
+        /**sin of every lane*/
+        template<typename Tier=precise, typename T, int W>
+        simd_pack<T, W> sin(const simd_pack<T, W>& x){
+            return sincos<Tier>(x).first;
+        }
+        /**cos of every lane*/
+        template<typename Tier=precise, typename T, int W>
+        simd_pack<T, W> cos(const simd_pack<T, W>& x){
+            return sincos<Tier>(x).second;
+        }
+    }
     
     /**
         @init first number in sequence
@@ -223,14 +1497,190 @@ namespace futilities{
         @returns new array of results of applying fn to sequence
     */
     template<typename Number, typename Function>
-    std::vector<Number> for_emplace_back(const Number& init, const Number& end, int n, Function&& fn){
-        std::vector<Number> myArray;
+    auto for_emplace_back(const Number& init, const Number& end, int n, Function&& fn){
+        std::vector<std::decay_t<decltype(fn(init))>> myArray;
+        myArray.reserve(std::max(n, 0));
         Number dx=(end-init)/(double)(n-1);
         for(int i=0; i<n; ++i){
             myArray.emplace_back(fn(init+dx*i));  
         }
         return myArray;
     }
+    namespace detail{
+        constexpr int GRID_BLOCK_SIZE=1024;
+        /**bools are evaluated into chars since std::vector<bool> packs bits and has no data()*/
+        template<typename Result>
+        struct grid_storage{
+            typedef Result type;
+        };
+        template<>
+        struct grid_storage<bool>{
+            typedef char type;
+        };
+        template<typename Result>
+        std::vector<Result> grid_result(std::vector<Result>&& stored){
+            return std::move(stored);
+        }
+        template<typename Result>
+        std::vector<Result> grid_result(std::vector<char>&& stored){
+            return std::vector<Result>(stored.begin(), stored.end());
+        }
+        /**
+            Evaluates fn on n grid points.  points(x, begin, m) writes the 
+            m points starting at index begin into x, then fn runs over the 
+            block with simd.  Blocks run in parallel
+        */
+        template<typename Number, typename Points, typename Function>
+        auto evaluate_grid(int n, Points&& points, Function&& fn){
+            typedef std::decay_t<decltype(fn(std::declval<const Number&>()))> Result;
+            typedef typename grid_storage<Result>::type Stored;
+            std::vector<Stored> result(std::max(n, 0));
+            Stored* data=result.data();
+            #pragma omp parallel for if(n>GRID_BLOCK_SIZE)
+            for(int block=0; block<n; block+=GRID_BLOCK_SIZE){
+                const int m=std::min(GRID_BLOCK_SIZE, n-block);
+                Number x[GRID_BLOCK_SIZE];
+                points(x, block, m);
+                FUTILITIES_OMP_SIMD
+                for(int i=0; i<m; ++i){
+                    data[block+i]=fn(x[i]);
+                }
+            }
+            return grid_result<Result>(std::move(result));
+        }
+        /**
+            Writes t*(begin+i) into x, then applies transform to x with 
+            packs so the math functions vectorize
+        */
+        template<typename T, typename Transform>
+        void fill_grid(T* x, int begin, int m, const T& t, Transform&& transform){
+            FUTILITIES_OMP_SIMD
+            for(int i=0; i<m; ++i){
+                x[i]=t*(T)(begin+i);
+            }
+            for_each_simd_range(x, 0, m, [&](const auto& val, int){
+                return transform(val);
+            });
+        }
+    }
+    /**
+        Parallel version of for_emplace_back.  The output is allocated 
+        once and fn may return a different type than Number.  This 
+        function runs in parallel when compiled with openmp enabled
+        @init first number in sequence
+        @end last number in sequence
+        @n total in sequence
+        @fn function to apply to number in sequence
+        @returns new array of results of applying fn to sequence
+    */
+    template<typename Number, typename Function=ops::identity>
+    auto for_emplace_back_parallel(const Number& init, const Number& end, int n, Function&& fn=Function()){
+        //a single point is init
+        const Number dx=n>1?(end-init)/(double)(n-1):Number(0);
+        return detail::evaluate_grid<Number>(n, [&](Number* x, int begin, int m){
+            FUTILITIES_OMP_SIMD
+            for(int i=0; i<m; ++i){
+                x[i]=init+dx*(begin+i);
+            }
+        }, fn);
+    }
+    /**
+        Geometric grid init*(end/init)^(i/(n-1)).  init and end must be
+        positive floats or doubles.  The ends are exact.  This function 
+        runs in parallel when compiled with openmp enabled
+        @init first number in sequence
+        @end last number in sequence
+        @n total in sequence
+        @fn function to apply to number in sequence
+        @returns new array of results of applying fn to sequence
+    */
+    template<typename Number, typename Function=ops::identity>
+    auto log_grid(const Number& init, const Number& end, int n, Function&& fn=Function()){
+        const Number logInit=std::log(init);
+        const Number dlog=(std::log(end)-logInit)/(Number)(n-1);
+        return detail::evaluate_grid<Number>(n, [&](Number* x, int begin, int m){
+            detail::fill_grid(x, begin, m, dlog, [&](const auto& val){
+                return math::exp(logInit+val);
+            });
+            if(begin==0){
+                x[0]=init;
+            }
+            //a single point is init
+            if(begin+m==n&&n>1){
+                x[m-1]=end;
+            }
+        }, fn);
+    }
+    /**
+        Chebyshev extrema (Chebyshev-Lobatto nodes) mapped to [a, b] in 
+        ascending order:  (a+b)/2-(b-a)/2*cos(pi*i/(n-1)), computed as 
+        (a+b)/2+(b-a)/2*sin(pi*(2i-n+1)/(2n-2)).  Includes both 
+        ends.  Number must be float or double.  This function runs in 
+        parallel when compiled with openmp enabled
+        @a lower bound
+        @b upper bound
+        @n number of nodes
+        @fn function to apply to every node
+        @returns new array of results of applying fn to the nodes
+    */
+    template<typename Number, typename Function=ops::identity>
+    auto chebyshev_grid(const Number& a, const Number& b, int n, Function&& fn=Function()){
+        const Number mid=(a+b)*Number(0.5);
+        const Number halfWidth=(b-a)*Number(0.5);
+        //sin of the angle measured from the middle keeps the nodes 
+        //exactly symmetric
+        const Number dTheta=Number(3.14159265358979323846)/(Number)(2*(n-1));
+        return detail::evaluate_grid<Number>(n, [&](Number* x, int begin, int m){
+            FUTILITIES_OMP_SIMD
+            for(int i=0; i<m; ++i){
+                x[i]=dTheta*(Number)(2*(begin+i)-(n-1));
+            }
+            detail::for_each_simd_range(x, 0, m, [&](const auto& val, int){
+                return mid+halfWidth*math::sin(val);
+            });
+            if(begin==0){
+                x[0]=a;
+            }
+            //a single node is a
+            if(begin+m==n&&n>1){
+                x[m-1]=b;
+            }
+        }, fn);
+    }
+    /**
+        Grid concentrated around center with spacing that grows like sinh
+        away from it:  center+intensity*sinh(c1+(c2-c1)*i/(n-1)) where 
+        c1=asinh((init-center)/intensity) and c2=asinh((end-center)/intensity).  
+        Small intensity clusters more points near center.  Number must be 
+        float or double.  This function runs in parallel when compiled with 
+        openmp enabled
+        @init first number in sequence
+        @end last number in sequence
+        @center point to concentrate the grid around
+        @intensity scale of the concentration
+        @n total in sequence
+        @fn function to apply to number in sequence
+        @returns new array of results of applying fn to sequence
+    */
+    template<typename Number, typename Function=ops::identity>
+    auto sinh_grid(const Number& init, const Number& end, const Number& center, const Number& intensity, int n, Function&& fn=Function()){
+        const Number c1=std::asinh((init-center)/intensity);
+        const Number dc=(std::asinh((end-center)/intensity)-c1)/(Number)(n-1);
+        const Number halfIntensity=intensity*Number(0.5);
+        return detail::evaluate_grid<Number>(n, [&](Number* x, int begin, int m){
+            detail::fill_grid(x, begin, m, dc, [&](const auto& val){
+                const auto growth=math::exp(c1+val);
+                return center+halfIntensity*(growth-Number(1)/growth);
+            });
+            if(begin==0){
+                x[0]=init;
+            }
+            //a single point is init
+            if(begin+m==n&&n>1){
+                x[m-1]=end;
+            }
+        }, fn);
+    }
     
     /**
         @array array to cumulate
@@ -251,9 +1701,125 @@ namespace futilities{
         return reduce_to_single(array, fn, array.front());
     }
     /**
-        @array array to cumulate
-        @fn function to apply to each element
-        @returns new array of results of applying fn to sequence and cumulative summing
+        Evaluates c[0]+c[1]x+c[2]x^2+... with Horner's rule
+        @coefficients array of coefficients, lowest order first
+        @x point to evaluate at
+        @returns value of the polynomial, zero without coefficients
+    */
+    template<typename Coefficients, typename Number>
+    auto horner(const Coefficients& coefficients, const Number& x){
+        const int n=coefficients.size();
+        if(n==0){
+            return decltype(coefficients[0]*Number(1))(0);
+        }
+        auto result=coefficients[n-1]*Number(1);
+        for(int k=n-2; k>=0; --k){
+            result=result*x+coefficients[k];
+        }
+        return result;
+    }
+    /**
+        Evaluates c[0]+c[1]x+c[2]x^2+... with Estrin's scheme on blocks of 
+        four coefficients and Horner's rule in x^4 across blocks.  The 
+        blocks do not depend on each other so the dependency chain is a 
+        quarter as long as plain Horner's rule.
+        @coefficients array of coefficients, lowest order first
+        @x point to evaluate at
+        @returns value of the polynomial, zero without coefficients
+    */
+    template<typename Coefficients, typename Number>
+    auto polynomial(const Coefficients& coefficients, const Number& x){
+        const int n=coefficients.size();
+        const Number x2=x*x;
+        const Number x4=x2*x2;
+        //the highest block may be partial
+        int k=n>0?((n-1)/4)*4:0;
+        auto result=decltype(coefficients[0]*Number(1))(0);
+        for(int j=n-1; j>=k; --j){
+            result=result*x+coefficients[j];
+        }
+        for(k-=4; k>=0; k-=4){
+            result=result*x4+((coefficients[k]+coefficients[k+1]*x)+(coefficients[k+2]+coefficients[k+3]*x)*x2);
+        }
+        return result;
+    }
+    namespace detail{
+        constexpr std::size_t largest_power_of_two_below(std::size_t n){
+            std::size_t result=1;
+            while(result*2<n){
+                result*=2;
+            }
+            return result;
+        }
+        /**Estrin's scheme over coefficients [Begin, Begin+Count), unrolled at compile time*/
+        template<std::size_t Begin, std::size_t Count>
+        struct estrin{
+            static constexpr std::size_t half=largest_power_of_two_below(Count);
+            template<typename Coefficients, typename Number>
+            static auto apply(const Coefficients& coefficients, const Number& x){
+                return estrin<Begin, half>::apply(coefficients, x)+
+                    estrin<Begin+half, Count-half>::apply(coefficients, x)*const_power<(int)half>(x);
+            }
+        };
+        template<std::size_t Begin>
+        struct estrin<Begin, 1>{
+            template<typename Coefficients, typename Number>
+            static auto apply(const Coefficients& coefficients, const Number&){
+                return coefficients[Begin]*Number(1);
+            }
+        };
+    }
+    /**
+        Evaluates c[0]+c[1]x+c[2]x^2+... with Estrin's scheme fully 
+        unrolled at compile time.  
+        @coefficients fixed size array of coefficients, lowest order first
+        @x point to evaluate at
+        @returns value of the polynomial
+    */
+    template<typename T, std::size_t N, typename Number>
+    auto polynomial(const std::array<T, N>& coefficients, const Number& x){
+        static_assert(N>0, "polynomial requires at least one coefficient");
+        return detail::estrin<0, N>::apply(coefficients, x);
+    }
+    /**
+        Evaluates a polynomial at many points.  Points are processed in 
+        blocks with Horner's rule running across the block so that the 
+        inner loop vectorizes over points.  This function runs in parallel 
+        when compiled with openmp enabled
+        @coefficients array of coefficients, lowest order first
+        @xs array of points to evaluate at
+        @returns vector of values of the polynomial at each point, zeros 
+        without coefficients
+    */
+    template<typename Coefficients, typename Array>
+    auto polynomial_parallel(const Coefficients& coefficients, const Array& xs){
+        typedef std::decay_t<decltype(coefficients[0]*xs[0])> T;
+        constexpr int blockSize=256;
+        const int n=xs.size();
+        const int numCoefficients=coefficients.size();
+        std::vector<T> result(n);
+        T* data=result.data();
+        #pragma omp parallel for
+        for(int block=0; block<n; block+=blockSize){
+            const int m=std::min(blockSize, n-block);
+            const T highest=numCoefficients>0?T(coefficients[numCoefficients-1]):T(0);
+            for(int i=0; i<m; ++i){
+                data[block+i]=highest;
+            }
+            for(int k=numCoefficients-2; k>=0; --k){
+                const auto coefficient=coefficients[k];
+                FUTILITIES_OMP_SIMD
+                for(int i=0; i<m; ++i){
+                    data[block+i]=data[block+i]*xs[block+i]+coefficient;
+                }
+            }
+        }
+        return result;
+    }
+    /**
+        @array array to cumulate
+        @fn function to apply to each element
+        @returns new array of results of applying fn to sequence and cumulative summing
     */
     template<typename Array, typename Function, typename OptionalFirstItem>
     auto reduce(Array&& array, Function&& fn, const OptionalFirstItem& item){
@@ -383,20 +1949,271 @@ namespace futilities{
     }
 
 
+    #if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+        #define FUTILITIES_ISA_DISPATCH
+        /**defines name_suffix, a copy of name_kernel compiled for the target*/
+        #define FUTILITIES_ISA_VARIANT(name, suffix, targetString) \
+            template<typename... Args> \
+            __attribute__((target(targetString))) auto name##_##suffix(Args... args){ \
+                return name##_kernel(args...); \
+            }
+        #define FUTILITIES_ISA_VARIANTS(name) \
+            FUTILITIES_ISA_VARIANT(name, sse42, "sse4.2") \
+            FUTILITIES_ISA_VARIANT(name, avx2, "avx2,fma") \
+            FUTILITIES_ISA_VARIANT(name, avx512, "avx512f,avx512dq,avx2,fma")
+        /**calls the variant of name for the active instruction set*/
+        #define FUTILITIES_ISA_CALL(name, ...) \
+            switch(active_isa()){ \
+                case isa::avx512: return detail::name##_avx512(__VA_ARGS__); \
+                case isa::avx2: return detail::name##_avx2(__VA_ARGS__); \
+                case isa::sse42: return detail::name##_sse42(__VA_ARGS__); \
+                default: return detail::name##_kernel(__VA_ARGS__); \
+            }
+    #else
+        #define FUTILITIES_ISA_VARIANTS(name)
+        #define FUTILITIES_ISA_CALL(name, ...) return detail::name##_kernel(__VA_ARGS__);
+    #endif
+
+    /**
+        Built in kernels over contiguous arrays compiled for several 
+        instruction sets.  The best instruction set the cpu supports is 
+        detected with cpuid the first time a kernel runs and every call 
+        after that goes straight to the matching variant.  Only gcc and 
+        clang on x86 build the variants; everything else runs the generic 
+        kernels, which are whatever the compiler flags allow.
+    */
+    namespace kernels{
+        enum class isa{generic=0, sse42=1, avx2=2, avx512=3};
+
+        /**highest instruction set the cpu supports*/
+        inline isa detect_isa(){
+            #ifdef FUTILITIES_ISA_DISPATCH
+                __builtin_cpu_init();
+                if(__builtin_cpu_supports("avx512f")&&__builtin_cpu_supports("avx512dq")){
+                    return isa::avx512;
+                }
+                if(__builtin_cpu_supports("avx2")&&__builtin_cpu_supports("fma")){
+                    return isa::avx2;
+                }
+                if(__builtin_cpu_supports("sse4.2")){
+                    return isa::sse42;
+                }
+            #endif
+            return isa::generic;
+        }
+        /**highest instruction set the cpu supports, detected once*/
+        inline isa supported_isa(){
+            static const isa level=detect_isa();
+            return level;
+        }
+        namespace detail{
+            /**atomic so that set_isa can run while kernels dispatch on other threads*/
+            inline std::atomic<isa>& active_isa_storage(){
+                static std::atomic<isa> level(supported_isa());
+                return level;
+            }
+        }
+        /**instruction set the kernels currently use*/
+        inline isa active_isa(){
+            return detail::active_isa_storage().load(std::memory_order_relaxed);
+        }
+        /**
+            Forces the kernels to use an instruction set, eg for benchmarks.  
+            Levels the cpu does not support fall back to the best one it does.
+            @level instruction set to use
+            @returns instruction set actually used
+        */
+        inline isa set_isa(isa level){
+            const isa used=std::min(level, supported_isa());
+            detail::active_isa_storage().store(used, std::memory_order_relaxed);
+            return used;
+        }
+
+        namespace detail{
+            /**independent partial sums so that the reductions vectorize without reassociation flags*/
+            constexpr int NUM_ACCUMULATORS=16;
+
+            template<typename T, typename Function>
+            FUTILITIES_ALWAYS_INLINE T transform_reduce_kernel(const T* x, int n, Function fn){
+                T partial[NUM_ACCUMULATORS]={};
+                int i=0;
+                for(; i+NUM_ACCUMULATORS<=n; i+=NUM_ACCUMULATORS){
+                    for(int j=0; j<NUM_ACCUMULATORS; ++j){
+                        partial[j]+=fn(x[i+j]);
+                    }
+                }
+                T result=0;
+                for(; i<n; ++i){
+                    result+=fn(x[i]);
+                }
+                for(int j=0; j<NUM_ACCUMULATORS; ++j){
+                    result+=partial[j];
+                }
+                return result;
+            }
+            template<typename T>
+            FUTILITIES_ALWAYS_INLINE T sum_kernel(const T* x, int n){
+                return transform_reduce_kernel(x, n, [](const T& val){return val;});
+            }
+            template<typename T>
+            FUTILITIES_ALWAYS_INLINE T dot_kernel(const T* x, const T* y, int n){
+                T partial[NUM_ACCUMULATORS]={};
+                int i=0;
+                for(; i+NUM_ACCUMULATORS<=n; i+=NUM_ACCUMULATORS){
+                    for(int j=0; j<NUM_ACCUMULATORS; ++j){
+                        partial[j]+=x[i+j]*y[i+j];
+                    }
+                }
+                T result=0;
+                for(; i<n; ++i){
+                    result+=x[i]*y[i];
+                }
+                for(int j=0; j<NUM_ACCUMULATORS; ++j){
+                    result+=partial[j];
+                }
+                return result;
+            }
+            template<typename T>
+            FUTILITIES_ALWAYS_INLINE void axpy_kernel(T a, const T* x, T* y, int n){
+                for(int i=0; i<n; ++i){
+                    y[i]+=a*x[i];
+                }
+            }
+            template<typename T>
+            FUTILITIES_ALWAYS_INLINE void inclusive_scan_kernel(const T* x, T* out, int n){
+                T running=0;
+                for(int i=0; i<n; ++i){
+                    running+=x[i];
+                    out[i]=running;
+                }
+            }
+            FUTILITIES_ISA_VARIANTS(transform_reduce)
+            FUTILITIES_ISA_VARIANTS(sum)
+            FUTILITIES_ISA_VARIANTS(dot)
+            FUTILITIES_ISA_VARIANTS(axpy)
+            FUTILITIES_ISA_VARIANTS(inclusive_scan)
+        }
+
+        /**
+            @x pointer to contiguous data
+            @n number of elements
+            @returns sum of the elements
+        */
+        template<typename T>
+        T sum(const T* x, int n){
+            FUTILITIES_ISA_CALL(sum, x, n)
+        }
+        /**
+            @x pointer to contiguous data
+            @y pointer to contiguous data
+            @n number of elements
+            @returns sum of x[i]*y[i]
+        */
+        template<typename T>
+        T dot(const T* x, const T* y, int n){
+            FUTILITIES_ISA_CALL(dot, x, y, n)
+        }
+        /**
+            Computes y=a*x+y in place
+            @a scalar
+            @x pointer to contiguous data
+            @y pointer to contiguous data to update
+            @n number of elements
+        */
+        template<typename T>
+        void axpy(T a, const T* x, T* y, int n){
+            FUTILITIES_ISA_CALL(axpy, a, x, y, n)
+        }
+        /**
+            @x pointer to contiguous data
+            @out pointer to contiguous output; may be the same as x
+            @n number of elements
+        */
+        template<typename T>
+        void inclusive_scan(const T* x, T* out, int n){
+            FUTILITIES_ISA_CALL(inclusive_scan, x, out, n)
+        }
+        /**
+            Fused transform and sum without an intermediate array.  fn 
+            should be a small inlinable functor.
+            @x pointer to contiguous data
+            @n number of elements
+            @fn function to apply to each element
+            @returns sum of fn(x[i])
+        */
+        template<typename T, typename Function>
+        T transform_reduce(const T* x, int n, Function fn){
+            FUTILITIES_ISA_CALL(transform_reduce, x, n, fn)
+        }
+    }
+
+
+    namespace detail{
+        /**elements per block when a kernel is split across threads*/
+        constexpr int KERNEL_BLOCK_SIZE=1<<14;
+
+        template<>
+        struct for_each_route<false>{
+            template<typename Array, typename Function>
+            static auto apply(Array&& array, Function&& fn){
+                for(auto it = array.begin(); it < array.end(); ++it){
+                    *it=fn(*it, it-array.begin());   
+                }
+                return std::move(array);
+            }
+        };
+        template<>
+        struct for_each_route<true>{
+            template<typename Array, typename Function>
+            static auto apply(Array&& array, Function&& fn){
+                return for_each_parallel_simd(std::move(array), fn);
+            }
+        };
+        template<>
+        struct sum_route<false>{
+            template<typename Array, typename Function>
+            static auto apply(const Array& array, Function&& fn){
+                auto it=array.begin();
+                auto myNum=fn(*it, 0);
+                ++it;
+                for(;it < array.end(); ++it){
+                    myNum+=fn(*it, it-array.begin());   
+                }
+                return myNum;
+            }
+        };
+        template<>
+        struct sum_route<true>{
+            template<typename Array, typename Function>
+            static auto apply(const Array& array, Function&& fn){
+                const int n=array.size();
+                const auto* data=array.data();
+                typedef std::remove_cv_t<std::remove_pointer_t<decltype(data)>> T;
+                if(n<=KERNEL_BLOCK_SIZE){
+                    return kernels::transform_reduce(data, n, fn);
+                }
+                //fixed blocks summed in order so the result does not depend on the number of threads
+                const int numBlocks=(n+KERNEL_BLOCK_SIZE-1)/KERNEL_BLOCK_SIZE;
+                std::vector<T> partial(numBlocks);
+                #pragma omp parallel for
+                for(int block=0; block<numBlocks; ++block){
+                    const int begin=block*KERNEL_BLOCK_SIZE;
+                    partial[block]=kernels::transform_reduce(data+begin, std::min(KERNEL_BLOCK_SIZE, n-begin), fn);
+                }
+                return kernels::sum(partial.data(), numBlocks);
+            }
+        };
+    }
+
     /**
+        fn from ops runs the vectorized parallel kernel for float and double arrays
         @array array to sum over
         @fn function to apply to each element
         @returns result of summing every element
     */
     template<typename Array, typename Function>
     auto sum(const Array& array, Function&& fn){
-        auto it=array.begin();
-        auto myNum=fn(*it, 0);
-        ++it;
-        for(;it < array.end(); ++it){
-            myNum+=fn(*it, it-array.begin());   
-        }
-        return myNum;
+        return detail::sum_route<detail::use_op_kernel<Array, Function>::value>::apply(array, fn);
     }
     
     /**
@@ -429,6 +2246,4061 @@ namespace futilities{
         return myNum;
     }
 
+    namespace detail{
+        /**elements per block in parallel reductions*/
+        constexpr int REDUCE_BLOCK_SIZE=4096;
+
+        template<bool Arithmetic>
+        struct block_sum;
+        /**partial sums kept by block_sum, enough for a vector register of any width*/
+        constexpr int BLOCK_SUM_LANES=8;
+        template<>
+        struct block_sum<true>{
+            template<typename T, typename Function>
+            static T apply(int begin, int end, Function& fn){
+                //explicit partial sums instead of a simd reduction clause, 
+                //which gcc does not vectorize inside a parallel region
+                T lanes[BLOCK_SUM_LANES]={};
+                int i=begin;
+                for(; i+BLOCK_SUM_LANES<=end; i+=BLOCK_SUM_LANES){
+                    FUTILITIES_OMP_SIMD
+                    for(int j=0; j<BLOCK_SUM_LANES; ++j){
+                        lanes[j]+=fn(i+j);
+                    }
+                }
+                T result=0;
+                for(; i<end; ++i){
+                    result+=fn(i);
+                }
+                for(int j=0; j<BLOCK_SUM_LANES; ++j){
+                    result+=lanes[j];
+                }
+                return result;
+            }
+        };
+        template<>
+        struct block_sum<false>{
+            template<typename T, typename Function>
+            static T apply(int begin, int end, Function& fn){
+                if(begin>=end){
+                    return T();
+                }
+                T result=fn(begin);
+                for(int i=begin+1; i<end; ++i){
+                    result+=fn(i);
+                }
+                return result;
+            }
+        };
+        /**
+            Sums fn(i) for i in [0, n) over fixed blocks in parallel.  The 
+            blocks do not depend on the number of threads and are added in 
+            order, so the result is reproducible.  An empty range sums 
+            to T().
+        */
+        template<typename Function>
+        auto parallel_sum(int n, Function&& fn){
+            typedef std::decay_t<decltype(fn(0))> T;
+            typedef block_sum<std::is_arithmetic<T>::value> block;
+            const int numBlocks=(n+REDUCE_BLOCK_SIZE-1)/REDUCE_BLOCK_SIZE;
+            if(numBlocks<=1){
+                return block::template apply<T>(0, n, fn);
+            }
+            std::vector<T> partial(numBlocks);
+            #pragma omp parallel for
+            for(int b=0; b<numBlocks; ++b){
+                partial[b]=block::template apply<T>(b*REDUCE_BLOCK_SIZE, std::min((b+1)*REDUCE_BLOCK_SIZE, n), fn);
+            }
+            T result=partial[0];
+            for(int b=1; b<numBlocks; ++b){
+                result+=partial[b];
+            }
+            return result;
+        }
+        /**true when every array of args has the length of the first*/
+        template<typename Tuple, std::size_t... I>
+        bool same_sizes(const Tuple& args, std::index_sequence<I...>){
+            bool result=true;
+            (void)std::initializer_list<int>{(result=result&&(std::size_t)std::get<I>(args).size()==(std::size_t)std::get<0>(args).size(), 0)...};
+            return result;
+        }
+        template<typename Tuple, std::size_t... I>
+        auto zip_sum_impl(const Tuple& args, std::index_sequence<I...>){
+            assert(same_sizes(args, std::index_sequence<I...>()));
+            const auto& fn=std::get<sizeof...(I)>(args);
+            return parallel_sum(std::get<0>(args).size(), [&](int i){
+                return fn(std::get<I>(args)[i]..., i);
+            });
+        }
+        template<typename Tuple, std::size_t... I>
+        void zip_for_each_impl(Tuple&& args, std::index_sequence<I...>){
+            assert(same_sizes(args, std::index_sequence<I...>()));
+            auto& fn=std::get<sizeof...(I)>(args);
+            auto& first=std::get<0>(args);
+            const int n=first.size();
+            FUTILITIES_OMP_PARALLEL_FOR_SIMD
+            for(int i=0; i<n; ++i){
+                first[i]=fn(std::get<I>(args)[i]..., i);
+            }
+        }
+        template<typename Tuple, std::size_t... I>
+        auto zip_transform_copy_impl(const Tuple& args, std::index_sequence<I...>){
+            assert(same_sizes(args, std::index_sequence<I...>()));
+            const auto& fn=std::get<sizeof...(I)>(args);
+            const int n=std::get<0>(args).size();
+            std::vector<std::decay_t<decltype(fn(std::get<I>(args)[0]..., 0))>> result(n);
+            FUTILITIES_OMP_PARALLEL_FOR_SIMD
+            for(int i=0; i<n; ++i){
+                result[i]=fn(std::get<I>(args)[i]..., i);
+            }
+            return result;
+        }
+    }
+    /**
+        Sums over several arrays of the same length at once.  This 
+        function runs in parallel when compiled with openmp enabled
+        @args arrays followed by a function taking (a[i], b[i], ..., i)
+        @returns result of summing fn over every index
+    */
+    template<typename... Args>
+    auto zip_sum(const Args&... args){
+        static_assert(sizeof...(Args)>=2, "zip_sum requires at least one array and a function");
+        return detail::zip_sum_impl(std::forward_as_tuple(args...), std::make_index_sequence<sizeof...(Args)-1>());
+    }
+    /**
+        Like for_each over several arrays of the same length.  The first 
+        array is overwritten.  This function runs in parallel when 
+        compiled with openmp enabled
+        @array array to overwrite
+        @args other arrays followed by a function taking (array[i], b[i], ..., i)
+        @returns first array with fn applied
+    */
+    template<typename Array, typename... Args>
+    auto zip_for_each(Array&& array, const Args&... args){
+        static_assert(sizeof...(Args)>=1, "zip_for_each requires a function");
+        detail::zip_for_each_impl(std::forward_as_tuple(array, args...), std::make_index_sequence<sizeof...(Args)>());
+        return std::move(array);
+    }
+    /**
+        Like for_each_parallel_copy over several arrays of the same length. 
+        This function runs in parallel when compiled with openmp enabled
+        @args arrays followed by a function taking (a[i], b[i], ..., i)
+        @returns new array of fn applied at every index
+    */
+    template<typename... Args>
+    auto zip_transform_copy(const Args&... args){
+        static_assert(sizeof...(Args)>=2, "zip_transform_copy requires at least one array and a function");
+        return detail::zip_transform_copy_impl(std::forward_as_tuple(args...), std::make_index_sequence<sizeof...(Args)-1>());
+    }
+    namespace detail{
+        template<bool UseKernel>
+        struct dot_route{
+            template<typename Array1, typename Array2>
+            static auto apply(const Array1& x, const Array2& y){
+                return zip_sum(x, y, [](const auto& a, const auto& b, int){
+                    return a*b;
+                });
+            }
+        };
+        template<>
+        struct dot_route<true>{
+            template<typename Array1, typename Array2>
+            static auto apply(const Array1& x, const Array2& y){
+                assert((std::size_t)x.size()==(std::size_t)y.size());
+                const int n=x.size();
+                const auto* a=x.data();
+                const auto* b=y.data();
+                const int numBlocks=(n+KERNEL_BLOCK_SIZE-1)/KERNEL_BLOCK_SIZE;
+                if(numBlocks<=1){
+                    return kernels::dot(a, b, n);
+                }
+                typedef std::remove_cv_t<std::remove_pointer_t<decltype(a)>> T;
+                std::vector<T> partial(numBlocks);
+                #pragma omp parallel for
+                for(int block=0; block<numBlocks; ++block){
+                    const int begin=block*KERNEL_BLOCK_SIZE;
+                    partial[block]=kernels::dot(a+begin, b+begin, std::min(KERNEL_BLOCK_SIZE, n-begin));
+                }
+                return kernels::sum(partial.data(), numBlocks);
+            }
+        };
+    }
+    /**
+        Dot product of two arrays of the same length.  Contiguous arrays of 
+        the same float or double type use the vectorized kernel.  This 
+        function runs in parallel when compiled with openmp enabled
+        @x first array
+        @y second array
+        @returns sum of x[i]*y[i]
+    */
+    template<typename Array1, typename Array2>
+    auto dot(const Array1& x, const Array2& y){
+        return detail::dot_route<
+            detail::is_contiguous_floating<Array1>::value&&
+            detail::is_contiguous_floating<Array2>::value&&
+            std::is_same<std::decay_t<decltype(x[0])>, std::decay_t<decltype(y[0])>>::value
+        >::apply(x, y);
+    }
+    /**
+        Weighted sum of a function of an array, eg a quadrature rule.  This 
+        function runs in parallel when compiled with openmp enabled
+        @weights array of weights
+        @array array of the same length
+        @fn function taking (value, index)
+        @returns sum of weights[i]*fn(array[i], i)
+    */
+    template<typename Weights, typename Array, typename Function>
+    auto weighted_sum(const Weights& weights, const Array& array, Function&& fn){
+        return zip_sum(weights, array, [&](const auto& weight, const auto& val, int i){
+            return weight*fn(val, i);
+        });
+    }
+
+    /**
+        Complex numbers stored as separate arrays of real and imaginary 
+        parts.  std::complex arrays interleave the parts so only half of 
+        every vector register does useful work; split storage lets the 
+        kernels below vectorize fully.  for_each, sum and cumulative_sum 
+        accept a complex_array and pass std::complex values to fn.
+    */
+    template<typename T>
+    struct complex_array{
+        typedef std::complex<T> value_type;
+        std::vector<T> real;
+        std::vector<T> imag;
+
+        complex_array()=default;
+        explicit complex_array(int n):real(n), imag(n){}
+        complex_array(std::vector<T> real_, std::vector<T> imag_):real(std::move(real_)), imag(std::move(imag_)){}
+        explicit complex_array(const std::vector<std::complex<T>>& array):real(array.size()), imag(array.size()){
+            const int n=array.size();
+            for(int i=0; i<n; ++i){
+                real[i]=array[i].real();
+                imag[i]=array[i].imag();
+            }
+        }
+        /**copies into interleaved storage*/
+        std::vector<std::complex<T>> to_vector() const{
+            const int n=size();
+            std::vector<std::complex<T>> result(n);
+            for(int i=0; i<n; ++i){
+                result[i]=std::complex<T>(real[i], imag[i]);
+            }
+            return result;
+        }
+        int size() const{
+            return real.size();
+        }
+        std::complex<T> operator[](int i) const{
+            return std::complex<T>(real[i], imag[i]);
+        }
+        void set(int i, const std::complex<T>& val){
+            real[i]=val.real();
+            imag[i]=val.imag();
+        }
+    };
+    /**
+        @array complex_array
+        @fn function taking (std::complex value, index) and returning a std::complex
+        @returns new array with fn applied to original array
+    */
+    template<typename T, typename Function>
+    auto for_each(complex_array<T>&& array, Function&& fn){
+        const int n=array.size();
+        T* re=array.real.data();
+        T* im=array.imag.data();
+        FUTILITIES_OMP_SIMD
+        for(int i=0; i<n; ++i){
+            const std::complex<T> result=fn(std::complex<T>(re[i], im[i]), i);
+            re[i]=result.real();
+            im[i]=result.imag();
+        }
+        return std::move(array);
+    }
+    template<typename T, typename Function>
+    auto for_each(complex_array<T>& array, Function&& fn){
+        return for_each(std::move(array), fn);
+    }
+    /**
+        The real and imaginary parts are accumulated separately
+        @array complex_array to sum over
+        @fn function taking (std::complex value, index)
+        @returns result of summing every element as a std::complex
+    */
+    template<typename T, typename Function>
+    auto sum(const complex_array<T>& array, Function&& fn){
+        const int n=array.size();
+        const T* re=array.real.data();
+        const T* im=array.imag.data();
+        T sumReal=0;
+        T sumImag=0;
+        FUTILITIES_OMP_SIMD_REDUCTION(+:sumReal, sumImag)
+        for(int i=0; i<n; ++i){
+            const auto result=fn(std::complex<T>(re[i], im[i]), i);
+            sumReal+=std::real(result);
+            sumImag+=std::imag(result);
+        }
+        return std::complex<T>(sumReal, sumImag);
+    }
+    /**
+        @array complex_array to cumulate
+        @fn function taking (std::complex value, index)
+        @returns new array of results of applying fn to sequence and cumulative summing
+    */
+    template<typename T, typename Function>
+    auto cumulative_sum(complex_array<T>&& array, Function&& fn){
+        const int n=array.size();
+        T* re=array.real.data();
+        T* im=array.imag.data();
+        T runningReal=0;
+        T runningImag=0;
+        for(int i=0; i<n; ++i){
+            const auto result=fn(std::complex<T>(re[i], im[i]), i);
+            runningReal+=std::real(result);
+            runningImag+=std::imag(result);
+            re[i]=runningReal;
+            im[i]=runningImag;
+        }
+        return std::move(array);
+    }
+    template<typename T, typename Function>
+    auto cumulative_sum(complex_array<T>& array, Function&& fn){
+        return cumulative_sum(std::move(array), fn);
+    }
+    /**
+        Multiplies element by element without the NaN recovery of 
+        std::complex multiplication, which keeps the loop vectorized
+        @array complex_array to overwrite
+        @other complex_array of the same length
+        @returns array times other
+    */
+    template<typename T>
+    auto complex_multiply(complex_array<T>&& array, const complex_array<T>& other){
+        const int n=array.size();
+        T* re=array.real.data();
+        T* im=array.imag.data();
+        const T* otherRe=other.real.data();
+        const T* otherIm=other.imag.data();
+        FUTILITIES_OMP_SIMD
+        for(int i=0; i<n; ++i){
+            const T newRe=re[i]*otherRe[i]-im[i]*otherIm[i];
+            im[i]=re[i]*otherIm[i]+im[i]*otherRe[i];
+            re[i]=newRe;
+        }
+        return std::move(array);
+    }
+    /**
+        @array complex_array to overwrite
+        @scalar complex number to multiply by
+        @returns array times scalar
+    */
+    template<typename T>
+    auto complex_multiply(complex_array<T>&& array, const std::complex<T>& scalar){
+        const int n=array.size();
+        T* re=array.real.data();
+        T* im=array.imag.data();
+        const T scalarRe=scalar.real();
+        const T scalarIm=scalar.imag();
+        FUTILITIES_OMP_SIMD
+        for(int i=0; i<n; ++i){
+            const T newRe=re[i]*scalarRe-im[i]*scalarIm;
+            im[i]=re[i]*scalarIm+im[i]*scalarRe;
+            re[i]=newRe;
+        }
+        return std::move(array);
+    }
+    namespace detail{
+        template<typename T>
+        FUTILITIES_ALWAYS_INLINE void complex_exp_at(T* re, T* im, int i){
+            const auto modulus=math::exp(re[i]);
+            const auto sinCos=math::sincos(im[i]);
+            re[i]=modulus*sinCos.second;
+            im[i]=modulus*sinCos.first;
+        }
+        template<bool Vectorized>
+        struct complex_exp_route;
+        template<>
+        struct complex_exp_route<true>{
+            template<typename T>
+            static void apply(T* re, T* im, int n){
+                typedef simd_pack<T> pack;
+                int i=0;
+                for(; i+pack::width<=n; i+=pack::width){
+                    const pack modulus=math::exp(pack::load(re+i));
+                    const auto sinCos=math::sincos(pack::load(im+i));
+                    (modulus*sinCos.second).store(re+i);
+                    (modulus*sinCos.first).store(im+i);
+                }
+                for(; i<n; ++i){
+                    complex_exp_at(re, im, i);
+                }
+            }
+        };
+        template<>
+        struct complex_exp_route<false>{
+            template<typename T>
+            static void apply(T* re, T* im, int n){
+                for(int i=0; i<n; ++i){
+                    const T modulus=std::exp(re[i]);
+                    const T imag=im[i];
+                    re[i]=modulus*std::cos(imag);
+                    im[i]=modulus*std::sin(imag);
+                }
+            }
+        };
+    }
+    /**
+        float and double arrays use the vectorized math::exp and math::sincos
+        @array complex_array to overwrite
+        @returns exp of every element
+    */
+    template<typename T>
+    auto complex_exp(complex_array<T>&& array){
+        detail::complex_exp_route<std::is_same<T, float>::value||std::is_same<T, double>::value>::apply(
+            array.real.data(), array.imag.data(), array.size()
+        );
+        return std::move(array);
+    }
+    /**
+        @array complex_array
+        @returns sum of every element
+    */
+    template<typename T>
+    std::complex<T> complex_accumulate(const complex_array<T>& array){
+        return std::complex<T>(
+            kernels::sum(array.real.data(), array.size()), 
+            kernels::sum(array.imag.data(), array.size())
+        );
+    }
+    /**
+        Fused multiply and sum, eg for characteristic function expansions
+        @array complex_array
+        @other complex_array of the same length
+        @returns sum of array[i]*other[i]
+    */
+    template<typename T>
+    std::complex<T> complex_multiply_accumulate(const complex_array<T>& array, const complex_array<T>& other){
+        const int n=array.size();
+        const T* re=array.real.data();
+        const T* im=array.imag.data();
+        const T* otherRe=other.real.data();
+        const T* otherIm=other.imag.data();
+        T sumReal=0;
+        T sumImag=0;
+        FUTILITIES_OMP_SIMD_REDUCTION(+:sumReal, sumImag)
+        for(int i=0; i<n; ++i){
+            sumReal+=re[i]*otherRe[i]-im[i]*otherIm[i];
+            sumImag+=re[i]*otherIm[i]+im[i]*otherRe[i];
+        }
+        return std::complex<T>(sumReal, sumImag);
+    }
+
+    namespace detail{
+        /**points handled together; their running state stays in L1*/
+        constexpr int BATCH_POINT_BLOCK=256;
+        /**terms per tile; the trig recurrence is reseeded at every tile*/
+        constexpr int BATCH_TERM_BLOCK=512;
+    }
+    /**
+        Computes result[j]=sum over k of fn(points[j], k) for every 
+        point.  This is a matrix-vector product with the matrix generated 
+        on the fly: blocks of points run in parallel and the inner loop 
+        runs over points so that it vectorizes.
+        @points array of points
+        @numTerms number of terms in the shared index series
+        @fn function taking (point, k)
+        @returns vector of sums, one per point
+    */
+    template<typename Array, typename Function>
+    auto batched_sum(const Array& points, int numTerms, Function&& fn){
+        typedef std::decay_t<decltype(fn(points[0], 0))> T;
+        const int n=points.size();
+        const int numBlocks=(n+detail::BATCH_POINT_BLOCK-1)/detail::BATCH_POINT_BLOCK;
+        std::vector<T> result(n, 0);
+        #pragma omp parallel for
+        for(int block=0; block<numBlocks; ++block){
+            const int begin=block*detail::BATCH_POINT_BLOCK;
+            const int end=std::min(begin+detail::BATCH_POINT_BLOCK, n);
+            for(int k=0; k<numTerms; ++k){
+                FUTILITIES_OMP_SIMD
+                for(int j=begin; j<end; ++j){
+                    result[j]+=fn(points[j], k);
+                }
+            }
+        }
+        return result;
+    }
+    /**
+        Computes result[j]=sum over k of coefs[k]*cos(k*du*(points[j]-a)),
+        the inversion step of Fourier-cosine expansions.  Rather than 
+        calling cos for every term, cos and sin of k*du*(x-a) are advanced 
+        by a rotation and recomputed exactly at the start of each tile of 
+        terms, which bounds the rounding drift.  Halve coefs[0] for the 
+        usual primed sum.
+        @points array of points
+        @coefs array of coefficients
+        @du frequency spacing
+        @a shift applied to every point
+        @returns vector of sums, one per point
+    */
+    template<typename Array, typename Coefs, typename Number>
+    auto fourier_cosine_sum(const Array& points, const Coefs& coefs, const Number& du, const Number& a=0){
+        typedef std::decay_t<decltype(coefs[0]*std::cos(du*(points[0]-a)))> T;
+        constexpr int width=detail::BATCH_POINT_BLOCK;
+        const int n=points.size();
+        const int numTerms=coefs.size();
+        const int numBlocks=(n+width-1)/width;
+        std::vector<T> result(n, 0);
+        #pragma omp parallel for
+        for(int block=0; block<numBlocks; ++block){
+            const int begin=block*width;
+            const int m=std::min(width, n-begin);
+            T theta[width], cosStep[width], sinStep[width], cosK[width], sinK[width], total[width];
+            for(int j=0; j<m; ++j){
+                theta[j]=du*(points[begin+j]-a);
+                cosStep[j]=std::cos(theta[j]);
+                sinStep[j]=std::sin(theta[j]);
+                total[j]=0;
+            }
+            for(int tile=0; tile<numTerms; tile+=detail::BATCH_TERM_BLOCK){
+                const int tileEnd=std::min(tile+detail::BATCH_TERM_BLOCK, numTerms);
+                for(int j=0; j<m; ++j){
+                    cosK[j]=std::cos(tile*theta[j]);
+                    sinK[j]=std::sin(tile*theta[j]);
+                }
+                for(int k=tile; k<tileEnd; ++k){
+                    const T coef=coefs[k];
+                    FUTILITIES_OMP_SIMD
+                    for(int j=0; j<m; ++j){
+                        total[j]+=coef*cosK[j];
+                        const T nextCos=cosK[j]*cosStep[j]-sinK[j]*sinStep[j];
+                        sinK[j]=sinK[j]*cosStep[j]+cosK[j]*sinStep[j];
+                        cosK[j]=nextCos;
+                    }
+                }
+            }
+            for(int j=0; j<m; ++j){
+                result[begin+j]=total[j];
+            }
+        }
+        return result;
+    }
+
+    /**
+        Fast Fourier transforms.  Forward transforms compute 
+        X[k]=sum over j of x[j]*exp(-2*pi*i*j*k/n) and inverse transforms 
+        use the opposite sign and divide by n, so inverse(forward(x))==x.  
+        Any length works: lengths made of small factors run a mixed-radix 
+        Stockham transform and lengths with a large prime factor use 
+        Bluestein's algorithm.
+    */
+    namespace fft{
+        namespace detail{
+            /**transforms at least this long parallelise each stage*/
+            constexpr int FFT_PARALLEL_SIZE=1<<15;
+            /**prime factors above this use Bluestein's algorithm*/
+            constexpr int FFT_MAX_RADIX=64;
+            /**rows handled together when a stage parallelises over its stride*/
+            constexpr int FFT_STRIDE_BLOCK=64;
+
+            /**multiplication without the NaN recovery of std::complex*/
+            template<typename T>
+            FUTILITIES_ALWAYS_INLINE std::complex<T> mul(const std::complex<T>& a, const std::complex<T>& b){
+                return std::complex<T>(a.real()*b.real()-a.imag()*b.imag(), a.real()*b.imag()+a.imag()*b.real());
+            }
+            template<bool Inverse, typename T>
+            FUTILITIES_ALWAYS_INLINE std::complex<T> twiddle(const std::complex<T>& a, const std::complex<T>& w){
+                return mul(a, Inverse?std::conj(w):w);
+            }
+            /**multiplies by -i for forward transforms and i for inverse ones*/
+            template<bool Inverse, typename T>
+            FUTILITIES_ALWAYS_INLINE std::complex<T> rotate(const std::complex<T>& a){
+                return Inverse?std::complex<T>(-a.imag(), a.real()):std::complex<T>(a.imag(), -a.real());
+            }
+            template<typename T>
+            std::complex<T> root_of_unity(long long k, long long n){
+                const double angle=-2.0*3.14159265358979323846*(double)(k%n)/(double)n;
+                return std::complex<T>(std::cos(angle), std::sin(angle));
+            }
+
+            struct stage{
+                int radix;
+                /**length of the sub-transforms this stage splits*/
+                int length;
+                /**offset into the plan's twiddles*/
+                int twiddleOffset;
+                /**offset into the plan's roots, for the generic radix*/
+                int rootOffset;
+            };
+
+            /**
+                One decimation-in-frequency Stockham pass: reads x with 
+                stride s and writes the sub-transforms of y in order, so no 
+                bit reversal is needed.  Processes q in [qBegin, qEnd) and 
+                r in [rBegin, rEnd).
+            */
+            template<bool Inverse, typename T>
+            void run_stage(
+                const std::complex<T>* x, std::complex<T>* y, int s, const stage& st,
+                const std::complex<T>* twiddles, const std::complex<T>* roots,
+                int qBegin, int qEnd, int rBegin, int rEnd
+            ){
+                const int p=st.radix;
+                const int m=st.length/p;
+                const std::complex<T>* tw=twiddles+st.twiddleOffset;
+                switch(p){
+                    case 2:
+                        for(int q=qBegin; q<qEnd; ++q){
+                            const std::complex<T> w1=tw[q];
+                            for(int r=rBegin; r<rEnd; ++r){
+                                const std::complex<T> a0=x[r+s*q];
+                                const std::complex<T> a1=x[r+s*(q+m)];
+                                y[r+s*2*q]=a0+a1;
+                                y[r+s*(2*q+1)]=twiddle<Inverse>(a0-a1, w1);
+                            }
+                        }
+                        break;
+                    case 3:{
+                        const T sinThird=(Inverse?1:-1)*std::sqrt(T(3))/2;
+                        for(int q=qBegin; q<qEnd; ++q){
+                            const std::complex<T> w1=tw[2*q], w2=tw[2*q+1];
+                            for(int r=rBegin; r<rEnd; ++r){
+                                const std::complex<T> a0=x[r+s*q];
+                                const std::complex<T> a1=x[r+s*(q+m)];
+                                const std::complex<T> a2=x[r+s*(q+2*m)];
+                                const std::complex<T> t=a1+a2;
+                                const std::complex<T> d=a1-a2;
+                                const std::complex<T> u(-sinThird*d.imag(), sinThird*d.real());
+                                const std::complex<T> c=a0-T(0.5)*t;
+                                y[r+s*3*q]=a0+t;
+                                y[r+s*(3*q+1)]=twiddle<Inverse>(c+u, w1);
+                                y[r+s*(3*q+2)]=twiddle<Inverse>(c-u, w2);
+                            }
+                        }
+                        break;
+                    }
+                    case 4:
+                        for(int q=qBegin; q<qEnd; ++q){
+                            const std::complex<T> w1=tw[3*q], w2=tw[3*q+1], w3=tw[3*q+2];
+                            for(int r=rBegin; r<rEnd; ++r){
+                                const std::complex<T> a0=x[r+s*q];
+                                const std::complex<T> a1=x[r+s*(q+m)];
+                                const std::complex<T> a2=x[r+s*(q+2*m)];
+                                const std::complex<T> a3=x[r+s*(q+3*m)];
+                                const std::complex<T> t0=a0+a2, t1=a0-a2;
+                                const std::complex<T> t2=a1+a3, t3=rotate<Inverse>(a1-a3);
+                                y[r+s*4*q]=t0+t2;
+                                y[r+s*(4*q+1)]=twiddle<Inverse>(t1+t3, w1);
+                                y[r+s*(4*q+2)]=twiddle<Inverse>(t0-t2, w2);
+                                y[r+s*(4*q+3)]=twiddle<Inverse>(t1-t3, w3);
+                            }
+                        }
+                        break;
+                    default:{
+                        const std::complex<T>* root=roots+st.rootOffset;
+                        for(int q=qBegin; q<qEnd; ++q){
+                            for(int r=rBegin; r<rEnd; ++r){
+                                for(int k=0; k<p; ++k){
+                                    std::complex<T> b=x[r+s*q];
+                                    for(int j=1, jk=k; j<p; ++j, jk=(jk+k)%p){
+                                        b+=twiddle<Inverse>(x[r+s*(q+j*m)], root[jk]);
+                                    }
+                                    y[r+s*(p*q+k)]=k==0?b:twiddle<Inverse>(b, tw[(p-1)*q+k-1]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+            Precomputed factorisation and twiddle factors for one length.  
+            Plans are immutable, so one plan can serve many threads; each 
+            call supplies its own workspace of work_size() elements.
+        */
+        template<typename T>
+        class plan{
+        public:
+            explicit plan(int n_):n(n_){
+                int remaining=n;
+                std::vector<int> factors;
+                while(remaining%4==0){
+                    factors.push_back(4);
+                    remaining/=4;
+                }
+                for(int p=2; p*p<=remaining; ++p){
+                    while(remaining%p==0){
+                        factors.push_back(p);
+                        remaining/=p;
+                    }
+                }
+                if(remaining>1){
+                    factors.push_back(remaining);
+                }
+                if(!factors.empty()&&*std::max_element(factors.begin(), factors.end())>detail::FFT_MAX_RADIX){
+                    init_bluestein();
+                    return;
+                }
+                int length=n;
+                for(int p:factors){
+                    detail::stage st{p, length, (int)twiddles.size(), (int)roots.size()};
+                    const int m=length/p;
+                    for(int q=0; q<m; ++q){
+                        for(int k=1; k<p; ++k){
+                            twiddles.push_back(detail::root_of_unity<T>((long long)q*k, length));
+                        }
+                    }
+                    if(p>4){
+                        for(int j=0; j<p; ++j){
+                            roots.push_back(detail::root_of_unity<T>(j, p));
+                        }
+                    }
+                    stages.push_back(st);
+                    length=m;
+                }
+            }
+            int size() const{
+                return n;
+            }
+            /**elements of workspace execute needs*/
+            int work_size() const{
+                return bluestein?bluestein->size()+bluestein->work_size():n;
+            }
+            /**
+                Unnormalised transform; in may equal out
+                @in pointer to n elements
+                @out pointer to n elements
+                @inverse true for the positive exponent
+                @work pointer to work_size() elements
+            */
+            void execute(const std::complex<T>* in, std::complex<T>* out, bool inverse, std::complex<T>* work) const{
+                if(inverse){
+                    run<true>(in, out, work);
+                }
+                else{
+                    run<false>(in, out, work);
+                }
+            }
+        private:
+            int n;
+            std::vector<detail::stage> stages;
+            std::vector<std::complex<T>> twiddles;
+            std::vector<std::complex<T>> roots;
+            /**power of two plan, chirp and transformed conjugate chirp for Bluestein*/
+            std::unique_ptr<plan<T>> bluestein;
+            std::vector<std::complex<T>> chirp;
+            std::vector<std::complex<T>> chirpTransform;
+
+            void init_bluestein(){
+                int m=1;
+                while(m<2*n-1){
+                    m*=2;
+                }
+                bluestein.reset(new plan<T>(m));
+                chirp.resize(n);
+                for(int k=0; k<n; ++k){
+                    chirp[k]=detail::root_of_unity<T>((long long)k*k, 2LL*n);
+                }
+                chirpTransform.assign(m, std::complex<T>(0));
+                for(int k=0; k<n; ++k){
+                    chirpTransform[k]=std::conj(chirp[k]);
+                    if(k>0){
+                        chirpTransform[m-k]=std::conj(chirp[k]);
+                    }
+                }
+                std::vector<std::complex<T>> work(bluestein->work_size());
+                bluestein->execute(chirpTransform.data(), chirpTransform.data(), false, work.data());
+            }
+            template<bool Inverse>
+            void run(const std::complex<T>* in, std::complex<T>* out, std::complex<T>* work) const{
+                if(bluestein){
+                    run_bluestein<Inverse>(in, out, work);
+                    return;
+                }
+                const int numStages=stages.size();
+                if(numStages==0){
+                    if(out!=in){
+                        out[0]=in[0];
+                    }
+                    return;
+                }
+                //alternate between out and work so that the last pass writes out
+                std::complex<T>* buffers[2]={out, work};
+                const std::complex<T>* src=in;
+                int dst=in==out?1:(numStages%2==0);
+                int s=1;
+                for(const auto& st:stages){
+                    run_stage<Inverse>(src, buffers[dst], s, st);
+                    src=buffers[dst];
+                    dst^=1;
+                    s*=st.radix;
+                }
+                if(src!=out){
+                    std::copy(src, src+n, out);
+                }
+            }
+            template<bool Inverse>
+            void run_stage(const std::complex<T>* x, std::complex<T>* y, int s, const detail::stage& st) const{
+                const int m=st.length/st.radix;
+                if(n<detail::FFT_PARALLEL_SIZE){
+                    detail::run_stage<Inverse>(x, y, s, st, twiddles.data(), roots.data(), 0, m, 0, s);
+                }
+                else if(m>=s){
+                    #pragma omp parallel for
+                    for(int q=0; q<m; ++q){
+                        detail::run_stage<Inverse>(x, y, s, st, twiddles.data(), roots.data(), q, q+1, 0, s);
+                    }
+                }
+                else{
+                    const int numBlocks=(s+detail::FFT_STRIDE_BLOCK-1)/detail::FFT_STRIDE_BLOCK;
+                    #pragma omp parallel for
+                    for(int block=0; block<numBlocks; ++block){
+                        const int r=block*detail::FFT_STRIDE_BLOCK;
+                        detail::run_stage<Inverse>(x, y, s, st, twiddles.data(), roots.data(), 0, m, r, std::min(r+detail::FFT_STRIDE_BLOCK, s));
+                    }
+                }
+            }
+            /**inverse transforms conjugate the input and output of the forward one*/
+            template<bool Inverse>
+            void run_bluestein(const std::complex<T>* in, std::complex<T>* out, std::complex<T>* work) const{
+                const int m=bluestein->size();
+                std::complex<T>* a=work;
+                std::complex<T>* subWork=work+m;
+                for(int k=0; k<n; ++k){
+                    a[k]=detail::mul(Inverse?std::conj(in[k]):in[k], chirp[k]);
+                }
+                std::fill(a+n, a+m, std::complex<T>(0));
+                bluestein->execute(a, a, false, subWork);
+                for(int k=0; k<m; ++k){
+                    a[k]=detail::mul(a[k], chirpTransform[k]);
+                }
+                bluestein->execute(a, a, true, subWork);
+                const T scale=T(1)/m;
+                for(int k=0; k<n; ++k){
+                    const std::complex<T> result=detail::mul(a[k], chirp[k])*scale;
+                    out[k]=Inverse?std::conj(result):result;
+                }
+            }
+        };
+
+        /**
+            Plans are built once per length and type and shared
+            @n length of the transform
+            @returns plan for length n
+        */
+        template<typename T>
+        std::shared_ptr<const plan<T>> get_plan(int n){
+            static std::mutex cacheMutex;
+            static std::map<int, std::shared_ptr<const plan<T>>> cache;
+            {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                auto found=cache.find(n);
+                if(found!=cache.end()){
+                    return found->second;
+                }
+            }
+            //build outside the lock so other lengths are not held up
+            auto built=std::make_shared<const plan<T>>(n);
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            return cache.emplace(n, built).first->second;
+        }
+
+        namespace detail{
+            template<typename T>
+            void transform(std::vector<std::complex<T>>& array, bool inverse){
+                const int n=array.size();
+                if(n==0){
+                    return;
+                }
+                const auto p=get_plan<T>(n);
+                std::vector<std::complex<T>> work(p->work_size());
+                p->execute(array.data(), array.data(), inverse, work.data());
+                if(inverse){
+                    const T scale=T(1)/n;
+                    for(auto& val:array){
+                        val*=scale;
+                    }
+                }
+            }
+        }
+
+        /**
+            @array complex array to transform in place
+            @returns forward transform of array
+        */
+        template<typename T>
+        auto forward(std::vector<std::complex<T>>&& array){
+            detail::transform(array, false);
+            return std::move(array);
+        }
+        /**
+            @array complex array
+            @returns forward transform of array
+        */
+        template<typename T>
+        auto forward_copy(const std::vector<std::complex<T>>& array){
+            return forward(std::vector<std::complex<T>>(array));
+        }
+        /**
+            @array complex array to transform in place
+            @returns inverse transform of array, divided by its length
+        */
+        template<typename T>
+        auto inverse(std::vector<std::complex<T>>&& array){
+            detail::transform(array, true);
+            return std::move(array);
+        }
+        /**
+            @array complex array
+            @returns inverse transform of array, divided by its length
+        */
+        template<typename T>
+        auto inverse_copy(const std::vector<std::complex<T>>& array){
+            return inverse(std::vector<std::complex<T>>(array));
+        }
+        /**
+            Even lengths pack pairs of reals into one complex transform of 
+            half the length.
+            @array real array
+            @returns first array.size()/2+1 terms of the forward transform; 
+            the rest are their conjugates
+        */
+        template<typename T>
+        std::vector<std::complex<T>> forward_real(const std::vector<T>& array){
+            const int n=array.size();
+            if(n%2==1||n==0){
+                std::vector<std::complex<T>> result(array.begin(), array.end());
+                result=forward(std::move(result));
+                result.resize(n/2+1);
+                return result;
+            }
+            const int half=n/2;
+            std::vector<std::complex<T>> packed(half);
+            for(int k=0; k<half; ++k){
+                packed[k]=std::complex<T>(array[2*k], array[2*k+1]);
+            }
+            packed=forward(std::move(packed));
+            std::vector<std::complex<T>> result(half+1);
+            for(int k=0; k<=half; ++k){
+                const std::complex<T> z=packed[k%half];
+                const std::complex<T> zMirror=std::conj(packed[(half-k)%half]);
+                const std::complex<T> even=(z+zMirror)*T(0.5);
+                const std::complex<T> odd=(z-zMirror)*std::complex<T>(0, -0.5);
+                result[k]=even+detail::mul(odd, detail::root_of_unity<T>(k, n));
+            }
+            return result;
+        }
+        /**
+            @array first n/2+1 terms of the transform of a real array
+            @n length of the real array
+            @returns real inverse transform, divided by n
+        */
+        template<typename T>
+        std::vector<T> inverse_real(const std::vector<std::complex<T>>& array, int n){
+            std::vector<T> result(n);
+            if(n%2==1){
+                std::vector<std::complex<T>> full(n);
+                for(int k=0; k<n; ++k){
+                    full[k]=k<=n/2?array[k]:std::conj(array[n-k]);
+                }
+                full=inverse(std::move(full));
+                for(int k=0; k<n; ++k){
+                    result[k]=full[k].real();
+                }
+                return result;
+            }
+            const int half=n/2;
+            std::vector<std::complex<T>> packed(half);
+            for(int k=0; k<half; ++k){
+                const std::complex<T> xMirror=std::conj(array[half-k]);
+                const std::complex<T> even=(array[k]+xMirror)*T(0.5);
+                const std::complex<T> odd=detail::mul((array[k]-xMirror)*T(0.5), std::conj(detail::root_of_unity<T>(k, n)));
+                packed[k]=even+std::complex<T>(-odd.imag(), odd.real());
+            }
+            packed=inverse(std::move(packed));
+            for(int k=0; k<half; ++k){
+                result[2*k]=packed[k].real();
+                result[2*k+1]=packed[k].imag();
+            }
+            return result;
+        }
+        /**
+            Transforms many arrays in parallel; arrays of one length share a plan
+            @arrays arrays to transform in place
+            @inverse true for inverse transforms
+            @returns transformed arrays
+        */
+        template<typename T>
+        auto transform_batch(std::vector<std::vector<std::complex<T>>>&& arrays, bool inverse=false){
+            const int numArrays=arrays.size();
+            #pragma omp parallel for schedule(dynamic)
+            for(int i=0; i<numArrays; ++i){
+                detail::transform(arrays[i], inverse);
+            }
+            return std::move(arrays);
+        }
+    }
+
+    /**
+        Output sizes for convolve and correlate, for a signal of length n 
+        and kernel of length k: full has n+k-1 elements, same has n 
+        (centred on the full output) and valid has n-k+1 (only outputs 
+        where the kernel lies inside the signal).
+    */
+    enum class convolution_mode{full, same, valid};
+    /**automatic picks direct or fft from the signal and kernel lengths*/
+    enum class convolution_method{automatic, direct, fft};
+
+    namespace detail{
+        /**outputs per block; blocks run in parallel*/
+        constexpr int CONVOLUTION_BLOCK=4096;
+        /**kernels at least this long use overlap-save when automatic*/
+        constexpr int CONVOLUTION_FFT_KERNEL=64;
+
+        /**
+            Writes full-convolution outputs [begin, end) to result.  Each 
+            kernel tap adds a shifted copy of the signal, so the inner 
+            loop is a vectorized axpy over a block of outputs.
+        */
+        template<typename T, typename Signal, typename Kernel>
+        void convolve_direct(const Signal& signal, const Kernel& kernel, int begin, int end, T* result){
+            const int n=signal.size();
+            const int k=kernel.size();
+            const int numBlocks=(end-begin+CONVOLUTION_BLOCK-1)/CONVOLUTION_BLOCK;
+            #pragma omp parallel for if(numBlocks>1)
+            for(int block=0; block<numBlocks; ++block){
+                const int blockBegin=begin+block*CONVOLUTION_BLOCK;
+                const int blockEnd=std::min(blockBegin+CONVOLUTION_BLOCK, end);
+                T* out=result+(blockBegin-begin);
+                std::fill(out, out+(blockEnd-blockBegin), T(0));
+                for(int tap=0; tap<k; ++tap){
+                    const int lo=std::max(blockBegin, tap);
+                    const int hi=std::min(blockEnd, tap+n);
+                    const T weight=kernel[tap];
+                    FUTILITIES_OMP_SIMD
+                    for(int i=lo; i<hi; ++i){
+                        out[i-blockBegin]+=weight*signal[i-tap];
+                    }
+                }
+            }
+        }
+
+        template<bool Floating>
+        struct convolve_fft;
+        template<>
+        struct convolve_fft<false>{
+            template<typename T, typename Signal, typename Kernel>
+            static void apply(const Signal& signal, const Kernel& kernel, int begin, int end, T* result){
+                convolve_direct(signal, kernel, begin, end, result);
+            }
+        };
+        /**
+            Overlap-save: each block of outputs is one circular convolution 
+            of a signal segment with the transformed kernel, discarding the 
+            k-1 wrapped outputs.  Blocks are independent and run in parallel.
+        */
+        template<>
+        struct convolve_fft<true>{
+            template<typename T, typename Signal, typename Kernel>
+            static void apply(const Signal& signal, const Kernel& kernel, int begin, int end, T* result){
+                const int n=signal.size();
+                const int k=kernel.size();
+                int fftSize=1024;
+                while(fftSize<4*k){
+                    fftSize*=2;
+                }
+                const int step=fftSize-k+1;
+                std::vector<T> padded(fftSize, T(0));
+                std::copy(kernel.begin(), kernel.end(), padded.begin());
+                const auto kernelTransform=fft::forward_real(padded);
+                const int numBlocks=(end-begin+step-1)/step;
+                #pragma omp parallel for if(numBlocks>1)
+                for(int block=0; block<numBlocks; ++block){
+                    const int blockBegin=begin+block*step;
+                    const int blockEnd=std::min(blockBegin+step, end);
+                    const int offset=blockBegin-k+1;
+                    std::vector<T> segment(fftSize, T(0));
+                    for(int i=std::max(0, -offset); i<fftSize&&offset+i<n; ++i){
+                        segment[i]=signal[offset+i];
+                    }
+                    auto transform=fft::forward_real(segment);
+                    const int numTerms=transform.size();
+                    for(int i=0; i<numTerms; ++i){
+                        transform[i]=fft::detail::mul(transform[i], kernelTransform[i]);
+                    }
+                    segment=fft::inverse_real(transform, fftSize);
+                    std::copy(segment.begin()+k-1, segment.begin()+k-1+(blockEnd-blockBegin), result+(blockBegin-begin));
+                }
+            }
+        };
+    }
+
+    /**
+        Computes result[i]=sum over j of kernel[j]*signal[i-j], ie 
+        for_each_exclude_last generalised to any number of taps.  Short 
+        kernels are applied directly with vectorized loops and long ones 
+        with overlap-save fft; both split the output into blocks that 
+        run in parallel.
+        @signal array to convolve
+        @kernel array of weights
+        @mode output size, see convolution_mode
+        @method direct, fft, or automatic to choose from the lengths
+        @returns convolved array
+    */
+    template<typename Signal, typename Kernel>
+    auto convolve(const Signal& signal, const Kernel& kernel, convolution_mode mode=convolution_mode::full, convolution_method method=convolution_method::automatic){
+        typedef std::decay_t<decltype(signal[0]*kernel[0])> T;
+        const int n=signal.size();
+        const int k=kernel.size();
+        int begin=0;
+        int end=0;
+        if(n>0&&k>0){
+            switch(mode){
+                case convolution_mode::full:
+                    end=n+k-1;
+                    break;
+                case convolution_mode::same:
+                    begin=(k-1)/2;
+                    end=begin+n;
+                    break;
+                case convolution_mode::valid:
+                    begin=k-1;
+                    end=std::max(n, begin);
+                    break;
+            }
+        }
+        std::vector<T> result(end-begin);
+        if(end==begin){
+            return result;
+        }
+        const bool useFft=method==convolution_method::fft||(
+            method==convolution_method::automatic&&k>=detail::CONVOLUTION_FFT_KERNEL&&end-begin>=k
+        );
+        if(useFft){
+            detail::convolve_fft<std::is_floating_point<T>::value>::apply(signal, kernel, begin, end, result.data());
+        }
+        else{
+            detail::convolve_direct(signal, kernel, begin, end, result.data());
+        }
+        return result;
+    }
+    /**
+        Computes result[i]=sum over j of kernel[j]*signal[i+j-(kernel.size()-1)],
+        ie convolve with the kernel reversed.  valid mode slides the 
+        kernel along the signal.
+        @signal array to correlate
+        @kernel array of weights
+        @mode output size, see convolution_mode
+        @method direct, fft, or automatic to choose from the lengths
+        @returns correlated array
+    */
+    template<typename Signal, typename Kernel>
+    auto correlate(const Signal& signal, const Kernel& kernel, convolution_mode mode=convolution_mode::full, convolution_method method=convolution_method::automatic){
+        std::vector<std::decay_t<decltype(kernel[0])>> reversed(kernel.rbegin(), kernel.rend());
+        return convolve(signal, reversed, mode, method);
+    }
+
+    /**
+        Solves a tridiagonal system with the Thomas algorithm: one forward 
+        sweep eliminating the lower diagonal and one backward substitution.  
+        Row i reads lower[i]*x[i-1]+diagonal[i]*x[i]+upper[i]*x[i+1]=rhs[i]; 
+        lower[0] and upper[n-1] are ignored.  Stable for diagonally 
+        dominant systems, no pivoting is done
+        @lower sub diagonal
+        @diagonal main diagonal
+        @upper super diagonal
+        @rhs right hand side, overwritten with the solution
+        @returns solution
+    */
+    template<typename Lower, typename Diagonal, typename Upper, typename Array>
+    auto tridiagonal_solve(const Lower& lower, const Diagonal& diagonal, const Upper& upper, Array&& rhs){
+        typedef std::decay_t<decltype(rhs[0])> T;
+        const int n=rhs.size();
+        if(n==0){
+            return std::move(rhs);
+        }
+        std::vector<T> modifiedUpper(n);
+        T pivot=diagonal[0];
+        modifiedUpper[0]=upper[0]/pivot;
+        rhs[0]=rhs[0]/pivot;
+        for(int i=1; i<n; ++i){
+            pivot=diagonal[i]-lower[i]*modifiedUpper[i-1];
+            modifiedUpper[i]=upper[i]/pivot;
+            rhs[i]=(rhs[i]-lower[i]*rhs[i-1])/pivot;
+        }
+        for(int i=n-2; i>=0; --i){
+            rhs[i]=rhs[i]-modifiedUpper[i]*rhs[i+1];
+        }
+        return std::move(rhs);
+    }
+
+    /**
+        Interpolation of values tabulated on a uniform grid, eg by 
+        for_emplace_back.  Since the grid is uniform the interval holding 
+        a point is found with one multiply instead of a binary search, 
+        and every interval stores its own cubic so evaluation is a gather 
+        and a Horner step.  linear, monotone_cubic and natural_spline 
+        build the interpolator; points outside the grid extrapolate the 
+        first or last piece.
+    */
+    namespace interpolation{
+        namespace detail{
+            /**query points handled together when evaluating in parallel*/
+            constexpr int INTERPOLATION_BLOCK_SIZE=4096;
+        }
+        /**
+            Piecewise cubic on a uniform grid.  Interval i holds 
+            a+b*u+c*u^2+d*u^3 where u=(x-x0)/dx-i is in [0, 1]
+        */
+        template<typename T>
+        class uniform_interpolator{
+        public:
+            /**
+                @x0_ first grid point
+                @dx_ grid spacing
+                @coefficients_ a, b, c, d for every interval, interval after interval
+            */
+            uniform_interpolator(const T& x0_, const T& dx_, std::vector<T>&& coefficients_):
+                x0(x0_), invDx(T(1)/dx_), numIntervals(coefficients_.size()/4), coefficients(std::move(coefficients_)){}
+            /**number of grid intervals*/
+            int size() const{
+                return numIntervals;
+            }
+            /**
+                @x point to evaluate at
+                @returns interpolated value
+            */
+            T operator()(const T& x) const{
+                const T t=(x-x0)*invDx;
+                //written so that NaN clamps to 0 before the conversion to int, and u keeps the NaN
+                const T clamped=t>T(0)?(t<T(numIntervals-1)?t:T(numIntervals-1)):T(0);
+                const int i=(int)clamped;
+                const T u=t-(T)i;
+                const T* c=coefficients.data()+4*i;
+                return c[0]+u*(c[1]+u*(c[2]+u*c[3]));
+            }
+            /**
+                Evaluates every query point.  This function runs in 
+                parallel when compiled with openmp enabled
+                @xs std-style contiguous container of query points
+                @returns interpolated values
+            */
+            template<typename Array>
+            std::vector<T> evaluate(const Array& xs) const{
+                const int n=xs.size();
+                std::vector<T> result(n);
+                T* data=result.data();
+                const auto* x=xs.data();
+                #pragma omp parallel for if(n>detail::INTERPOLATION_BLOCK_SIZE)
+                for(int block=0; block<n; block+=detail::INTERPOLATION_BLOCK_SIZE){
+                    const int end=std::min(block+detail::INTERPOLATION_BLOCK_SIZE, n);
+                    FUTILITIES_OMP_SIMD
+                    for(int i=block; i<end; ++i){
+                        data[i]=(*this)(x[i]);
+                    }
+                }
+                return result;
+            }
+        private:
+            T x0;
+            T invDx;
+            int numIntervals;
+            std::vector<T> coefficients;
+        };
+        namespace detail{
+            /**
+                Hermite cubic on every interval from the values and the 
+                slopes per interval (derivative times dx)
+            */
+            template<typename T, typename Array>
+            uniform_interpolator<T> hermite(const T& x0, const T& x1, const Array& values, const std::vector<T>& slopes){
+                const int numIntervals=values.size()-1;
+                std::vector<T> coefficients(4*numIntervals);
+                FUTILITIES_OMP_SIMD
+                for(int i=0; i<numIntervals; ++i){
+                    const T delta=values[i+1]-values[i];
+                    coefficients[4*i]=values[i];
+                    coefficients[4*i+1]=slopes[i];
+                    coefficients[4*i+2]=T(3)*delta-T(2)*slopes[i]-slopes[i+1];
+                    coefficients[4*i+3]=slopes[i]+slopes[i+1]-T(2)*delta;
+                }
+                return uniform_interpolator<T>(x0, (x1-x0)/(T)numIntervals, std::move(coefficients));
+            }
+            /**sign of the value as -1, 0 or 1*/
+            template<typename T>
+            T sign(const T& val){
+                return (T(0)<val)-(val<T(0));
+            }
+            /**three point end slope, limited so the end stays monotone*/
+            template<typename T>
+            T monotone_end_slope(const T& delta0, const T& delta1){
+                const T slope=(T(3)*delta0-delta1)*T(0.5);
+                if(sign(slope)!=sign(delta0)){
+                    return T(0);
+                }
+                if(sign(delta0)!=sign(delta1)&&std::abs(slope)>T(3)*std::abs(delta0)){
+                    return T(3)*delta0;
+                }
+                return slope;
+            }
+        }
+        /**
+            Piecewise linear interpolation
+            @x0 first grid point
+            @x1 last grid point
+            @values values at the values.size() equally spaced grid points, at least two
+            @returns interpolator
+        */
+        template<typename Number, typename Array>
+        auto linear(const Number& x0, const Number& x1, const Array& values){
+            typedef std::decay_t<decltype(values[0])> T;
+            const int numIntervals=values.size()-1;
+            std::vector<T> coefficients(4*numIntervals);
+            FUTILITIES_OMP_SIMD
+            for(int i=0; i<numIntervals; ++i){
+                coefficients[4*i]=values[i];
+                coefficients[4*i+1]=values[i+1]-values[i];
+                coefficients[4*i+2]=T(0);
+                coefficients[4*i+3]=T(0);
+            }
+            return uniform_interpolator<T>(x0, (x1-x0)/(T)numIntervals, std::move(coefficients));
+        }
+        /**
+            Monotone piecewise cubic (Fritsch-Butland slopes, as in pchip).  
+            The interpolant does not overshoot: it is monotone wherever the 
+            data are and flat at local extrema
+            @x0 first grid point
+            @x1 last grid point
+            @values values at the values.size() equally spaced grid points, at least two
+            @returns interpolator
+        */
+        template<typename Number, typename Array>
+        auto monotone_cubic(const Number& x0, const Number& x1, const Array& values){
+            typedef std::decay_t<decltype(values[0])> T;
+            const int n=values.size();
+            std::vector<T> slopes(n);
+            if(n==2){
+                slopes[0]=slopes[1]=values[1]-values[0];
+            }
+            else{
+                for(int i=1; i<n-1; ++i){
+                    const T before=values[i]-values[i-1];
+                    const T after=values[i+1]-values[i];
+                    //harmonic mean, zero at extrema
+                    slopes[i]=before*after>T(0)?T(2)*before*after/(before+after):T(0);
+                }
+                slopes[0]=detail::monotone_end_slope(values[1]-values[0], values[2]-values[1]);
+                slopes[n-1]=detail::monotone_end_slope(values[n-1]-values[n-2], values[n-2]-values[n-3]);
+            }
+            return detail::hermite((T)x0, (T)x1, values, slopes);
+        }
+        /**
+            Natural cubic spline:  twice continuously differentiable with 
+            zero second derivative at both ends.  The second derivatives 
+            come from tridiagonal_solve
+            @x0 first grid point
+            @x1 last grid point
+            @values values at the values.size() equally spaced grid points, at least two
+            @returns interpolator
+        */
+        template<typename Number, typename Array>
+        auto natural_spline(const Number& x0, const Number& x1, const Array& values){
+            typedef std::decay_t<decltype(values[0])> T;
+            const int n=values.size();
+            //second derivatives times dx^2; the ends are zero
+            std::vector<T> curvature(n, T(0));
+            if(n>2){
+                const int m=n-2;
+                std::vector<T> offDiagonal(m, T(1));
+                std::vector<T> diagonal(m, T(4));
+                std::vector<T> rhs(m);
+                for(int i=0; i<m; ++i){
+                    rhs[i]=T(6)*(values[i+2]-T(2)*values[i+1]+values[i]);
+                }
+                rhs=futilities::tridiagonal_solve(offDiagonal, diagonal, offDiagonal, std::move(rhs));
+                std::copy(rhs.begin(), rhs.end(), curvature.begin()+1);
+            }
+            const int numIntervals=n-1;
+            std::vector<T> coefficients(4*numIntervals);
+            FUTILITIES_OMP_SIMD
+            for(int i=0; i<numIntervals; ++i){
+                coefficients[4*i]=values[i];
+                coefficients[4*i+1]=values[i+1]-values[i]-(T(2)*curvature[i]+curvature[i+1])/T(6);
+                coefficients[4*i+2]=curvature[i]*T(0.5);
+                coefficients[4*i+3]=(curvature[i+1]-curvature[i])/T(6);
+            }
+            return uniform_interpolator<T>(x0, (x1-x0)/(T)numIntervals, std::move(coefficients));
+        }
+    }
+
+    /**
+        Chebyshev proxies for expensive smooth functions.  approximate 
+        samples fn at Chebyshev nodes, doubling the number of nodes until 
+        the expansion resolves fn to the requested tolerance, and returns 
+        a proxy that evaluates the expansion with Clenshaw's recurrence.  
+        The proxy can be passed wherever fn was, eg 
+        for_each_parallel(begin, end, proxy).
+    */
+    namespace chebyshev{
+        namespace detail{
+            /**nodes sampled before the first doubling, minus one*/
+            constexpr int CHEBYSHEV_INITIAL_DEGREE=16;
+            /**trailing coefficients that must be negligible to stop doubling*/
+            constexpr int CHEBYSHEV_TAIL=4;
+            /**query points handled together when evaluating in parallel*/
+            constexpr int CHEBYSHEV_BLOCK_SIZE=1024;
+            /**
+                Node j of the degree+1 Chebyshev-Lobatto nodes in ascending 
+                order, as chebyshev_grid computes them
+            */
+            template<typename T>
+            T node(const T& mid, const T& halfWidth, int j, int degree){
+                return mid+halfWidth*std::sin(T(3.14159265358979323846)*(T)(2*j-degree)/(T)(2*degree));
+            }
+            /**
+                Coefficients of the interpolant through values at the 
+                ascending nodes, from a DCT-I computed with a real fft of 
+                the even extension
+            */
+            template<typename T>
+            std::vector<T> coefficients(const std::vector<T>& values){
+                const int degree=values.size()-1;
+                std::vector<T> extended(2*degree);
+                for(int j=0; j<=degree; ++j){
+                    extended[j]=values[degree-j];
+                }
+                for(int j=1; j<degree; ++j){
+                    extended[2*degree-j]=values[degree-j];
+                }
+                const auto transform=fft::forward_real(extended);
+                std::vector<T> result(degree+1);
+                for(int k=0; k<=degree; ++k){
+                    result[k]=transform[k].real()/(T)degree;
+                }
+                result[0]*=T(0.5);
+                result[degree]*=T(0.5);
+                return result;
+            }
+        }
+        /**
+            Callable Chebyshev expansion on [a, b].  Points outside [a, b] 
+            extrapolate the polynomial, which loses accuracy quickly
+        */
+        template<typename T>
+        class proxy{
+        public:
+            /**
+                @a_ lower bound
+                @b_ upper bound
+                @coefficients_ Chebyshev coefficients, lowest degree first
+            */
+            proxy(const T& a_, const T& b_, std::vector<T>&& coefficients_):
+                mid((a_+b_)*T(0.5)), invHalfWidth(T(2)/(b_-a_)), coefficients(std::move(coefficients_)){}
+            /**degree of the expansion*/
+            int degree() const{
+                return coefficients.size()-1;
+            }
+            const std::vector<T>& get_coefficients() const{
+                return coefficients;
+            }
+            /**
+                @x point to evaluate at
+                @returns value of the expansion
+            */
+            T operator()(const T& x) const{
+                const T t=(x-mid)*invHalfWidth;
+                const T twoT=t+t;
+                const T* c=coefficients.data();
+                T b1=T(0);
+                T b2=T(0);
+                for(int k=coefficients.size()-1; k>0; --k){
+                    const T b0=c[k]+twoT*b1-b2;
+                    b2=b1;
+                    b1=b0;
+                }
+                return c[0]+t*b1-b2;
+            }
+            /**same as operator()(x) so the proxy works as a for_each lambda*/
+            template<typename Index>
+            T operator()(const T& x, const Index&) const{
+                return (*this)(x);
+            }
+            /**
+                Evaluates every query point, running Clenshaw's recurrence 
+                for a block of points at once.  This function runs in 
+                parallel when compiled with openmp enabled
+                @xs std-style contiguous container of query points
+                @returns values of the expansion
+            */
+            template<typename Array>
+            std::vector<T> evaluate(const Array& xs) const{
+                const int n=xs.size();
+                const int numCoefficients=coefficients.size();
+                std::vector<T> result(n);
+                T* data=result.data();
+                const auto* x=xs.data();
+                const T* c=coefficients.data();
+                #pragma omp parallel for if(n>detail::CHEBYSHEV_BLOCK_SIZE)
+                for(int block=0; block<n; block+=detail::CHEBYSHEV_BLOCK_SIZE){
+                    const int m=std::min(detail::CHEBYSHEV_BLOCK_SIZE, n-block);
+                    T t[detail::CHEBYSHEV_BLOCK_SIZE];
+                    T b1[detail::CHEBYSHEV_BLOCK_SIZE];
+                    T b2[detail::CHEBYSHEV_BLOCK_SIZE];
+                    FUTILITIES_OMP_SIMD
+                    for(int i=0; i<m; ++i){
+                        t[i]=(x[block+i]-mid)*invHalfWidth;
+                        b1[i]=T(0);
+                        b2[i]=T(0);
+                    }
+                    for(int k=numCoefficients-1; k>0; --k){
+                        const T ck=c[k];
+                        FUTILITIES_OMP_SIMD
+                        for(int i=0; i<m; ++i){
+                            const T b0=ck+T(2)*t[i]*b1[i]-b2[i];
+                            b2[i]=b1[i];
+                            b1[i]=b0;
+                        }
+                    }
+                    FUTILITIES_OMP_SIMD
+                    for(int i=0; i<m; ++i){
+                        data[block+i]=c[0]+t[i]*b1[i]-b2[i];
+                    }
+                }
+                return result;
+            }
+        private:
+            T mid;
+            T invHalfWidth;
+            std::vector<T> coefficients;
+        };
+        /**
+            Samples fn at Chebyshev nodes on [a, b] in parallel, doubling 
+            the nodes (and reusing the old samples) until the trailing 
+            coefficients fall below tolerance times the largest sample.  
+            Trailing coefficients that together stay below that bound are 
+            then dropped.  If maxDegree is reached first the expansion of 
+            that degree is returned.  fn is called from several threads 
+            when compiled with openmp enabled
+            @a lower bound
+            @b upper bound
+            @fn smooth function of one argument
+            @tolerance relative accuracy to resolve
+            @maxDegree largest degree to sample, at least one
+            @returns proxy evaluating the expansion
+        */
+        template<typename Number, typename Function>
+        auto approximate(const Number& a, const Number& b, Function&& fn, const Number& tolerance=Number(1e-14), int maxDegree=1<<16){
+            typedef std::decay_t<decltype(fn(a))> T;
+            const T mid=(a+b)*T(0.5);
+            const T halfWidth=(b-a)*T(0.5);
+            //a single interval needs at least degree one
+            int degree=std::max(1, std::min(detail::CHEBYSHEV_INITIAL_DEGREE, maxDegree));
+            std::vector<T> values(degree+1);
+            #pragma omp parallel for
+            for(int j=0; j<=degree; ++j){
+                values[j]=fn(j==0?T(a):j==degree?T(b):detail::node(mid, halfWidth, j, degree));
+            }
+            while(true){
+                auto coefficients=detail::coefficients(values);
+                T scale=T(0);
+                for(const auto& val:values){
+                    scale=std::max(scale, std::abs(val));
+                }
+                const T bound=tolerance*std::max(scale, std::numeric_limits<T>::min());
+                T tail=T(0);
+                for(int k=std::max(1, degree-detail::CHEBYSHEV_TAIL+1); k<=degree; ++k){
+                    tail=std::max(tail, std::abs(coefficients[k]));
+                }
+                if(tail<=bound||2*degree>maxDegree){
+                    T dropped=T(0);
+                    int keep=degree+1;
+                    while(keep>1&&dropped+std::abs(coefficients[keep-1])<=bound){
+                        dropped+=std::abs(coefficients[keep-1]);
+                        --keep;
+                    }
+                    coefficients.resize(keep);
+                    return proxy<T>(a, b, std::move(coefficients));
+                }
+                //the old nodes are the even nodes of the doubled set
+                std::vector<T> doubled(2*degree+1);
+                for(int j=0; j<=degree; ++j){
+                    doubled[2*j]=values[j];
+                }
+                #pragma omp parallel for
+                for(int j=0; j<degree; ++j){
+                    doubled[2*j+1]=fn(detail::node(mid, halfWidth, 2*j+1, 2*degree));
+                }
+                values=std::move(doubled);
+                degree*=2;
+            }
+        }
+    }
+
+    /**
+        Fixed quadrature rules.  Integrands are evaluated in parallel over 
+        fixed blocks with the weight multiplied inside the simd reduction, 
+        so results are reproducible for any number of threads.  The 
+        *_rule functions return the nodes and weights instead, for 
+        integrate and for integrate_batch, which integrates one integrand 
+        for many parameters at once.
+    */
+    namespace quadrature{
+        /**nodes and weights of a rule on a fixed interval*/
+        template<typename T>
+        struct rule{
+            std::vector<T> nodes;
+            std::vector<T> weights;
+            int size() const{
+                return nodes.size();
+            }
+        };
+        namespace detail{
+            /**tanh-sinh nodes are taken for |t| up to this*/
+            constexpr double TANH_SINH_MAX_T=4.0;
+            /**tanh-sinh stops halving the step after this many levels*/
+            constexpr int TANH_SINH_MAX_LEVEL=10;
+            constexpr double HALF_PI=1.57079632679489661923;
+
+            /**Gauss-Legendre rule on [-1, 1] by Newton's method on the three term recurrence*/
+            template<typename T>
+            rule<T> build_gauss_legendre(int order){
+                rule<T> result;
+                result.nodes.resize(order);
+                result.weights.resize(order);
+                for(int i=0; i<(order+1)/2; ++i){
+                    long double x=std::cos(3.14159265358979323846L*(i+0.75L)/(order+0.5L));
+                    long double derivative=1;
+                    for(int iteration=0; iteration<100; ++iteration){
+                        long double p0=1;
+                        long double p1=x;
+                        for(int k=2; k<=order; ++k){
+                            const long double p2=((2*k-1)*x*p1-(k-1)*p0)/k;
+                            p0=p1;
+                            p1=p2;
+                        }
+                        derivative=order*(x*p1-p0)/(x*x-1);
+                        const long double step=p1/derivative;
+                        x-=step;
+                        if(std::abs(step)<=1e-19L){
+                            break;
+                        }
+                    }
+                    const long double weight=2/((1-x*x)*derivative*derivative);
+                    //ascending order, symmetric about zero
+                    result.nodes[i]=(T)-x;
+                    result.nodes[order-1-i]=(T)x;
+                    result.weights[i]=result.weights[order-1-i]=(T)weight;
+                }
+                if(order%2==1){
+                    result.nodes[order/2]=T(0);
+                }
+                return result;
+            }
+            /**
+                Abscissa and weight of the tanh-sinh rule at t for [a, b].  
+                The distance to the nearer end is computed directly so 
+                nodes close to the ends keep their precision
+            */
+            template<typename T>
+            void tanh_sinh_node(const T& a, const T& b, double t, T& x, T& weight){
+                const double u=HALF_PI*std::sinh(t);
+                const double coshU=std::cosh(u);
+                const double complement=1.0/(std::exp(std::abs(u))*coshU);
+                const T halfWidth=(b-a)*T(0.5);
+                x=t<0?a+halfWidth*(T)complement:b-halfWidth*(T)complement;
+                weight=halfWidth*(T)(HALF_PI*std::cosh(t)/(coshU*coshU));
+            }
+        }
+        /**
+            Nodes and weights of Gauss-Legendre rules on [-1, 1], computed 
+            once per order and shared between threads
+            @order number of nodes
+            @returns rule with ascending nodes
+        */
+        template<typename T>
+        std::shared_ptr<const rule<T>> get_gauss_legendre(int order){
+            static std::mutex cacheMutex;
+            static std::map<int, std::shared_ptr<const rule<T>>> cache;
+            {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                auto found=cache.find(order);
+                if(found!=cache.end()){
+                    return found->second;
+                }
+            }
+            auto built=std::make_shared<const rule<T>>(detail::build_gauss_legendre<T>(order));
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            return cache.emplace(order, built).first->second;
+        }
+
+        /**
+            Composite trapezoid rule.  This function runs in parallel when 
+            compiled with openmp enabled
+            @a lower bound
+            @b upper bound
+            @n number of intervals, at least one
+            @fn integrand
+            @returns integral of fn over [a, b]
+        */
+        template<typename Number, typename Function>
+        auto trapezoid(const Number& a, const Number& b, int n, Function&& fn){
+            n=std::max(n, 1);
+            const Number h=(b-a)/(Number)n;
+            return h*futilities::detail::parallel_sum(n+1, [&](int i){
+                //arithmetic rather than a branch so the reduction vectorizes
+                const Number weight=Number(1)-Number(0.5)*(Number)((i==0)+(i==n));
+                return weight*fn(a+h*i);
+            });
+        }
+        /**
+            Composite Simpson rule.  This function runs in parallel when 
+            compiled with openmp enabled
+            @a lower bound
+            @b upper bound
+            @n number of intervals, rounded up to a positive even number
+            @fn integrand
+            @returns integral of fn over [a, b]
+        */
+        template<typename Number, typename Function>
+        auto simpson(const Number& a, const Number& b, int n, Function&& fn){
+            n=std::max(n, 1);
+            n+=n%2;
+            const Number h=(b-a)/(Number)n;
+            return h/Number(3)*futilities::detail::parallel_sum(n+1, [&](int i){
+                const Number weight=(Number)(2+2*(i&1)-(i==0)-(i==n));
+                return weight*fn(a+h*i);
+            });
+        }
+        /**
+            Composite Gauss-Legendre rule with cached nodes and weights.  
+            This function runs in parallel when compiled with openmp enabled
+            @a lower bound
+            @b upper bound
+            @order nodes per panel
+            @fn integrand
+            @numPanels number of equal panels [a, b] is split into
+            @returns integral of fn over [a, b]
+        */
+        template<typename Number, typename Function>
+        auto gauss_legendre(const Number& a, const Number& b, int order, Function&& fn, int numPanels=1){
+            const auto base=get_gauss_legendre<Number>(order);
+            const Number* nodes=base->nodes.data();
+            const Number* weights=base->weights.data();
+            const Number halfWidth=(b-a)/(Number)(2*numPanels);
+            return halfWidth*futilities::detail::parallel_sum(order*numPanels, [&](int i){
+                const int panel=i/order;
+                const int j=i-panel*order;
+                return weights[j]*fn(a+halfWidth*((Number)(2*panel+1)+nodes[j]));
+            });
+        }
+        /**
+            Tanh-sinh (double exponential) rule, which converges quickly 
+            even with end point singularities; fn is never called at a or 
+            b.  The step is halved, reusing earlier nodes, until successive 
+            estimates agree to tolerance.  This function runs in parallel 
+            when compiled with openmp enabled
+            @a lower bound
+            @b upper bound
+            @fn integrand
+            @tolerance relative change between levels to stop at
+            @returns integral of fn over [a, b]
+        */
+        template<typename Number, typename Function>
+        auto tanh_sinh(const Number& a, const Number& b, Function&& fn, const Number& tolerance=Number(1e-12)){
+            typedef std::decay_t<decltype(Number(1)*fn(a))> Result;
+            auto term=[&](double t){
+                Number x, weight;
+                detail::tanh_sinh_node(a, b, t, x, weight);
+                return a<x&&x<b?Result(weight*fn(x)):Result(0);
+            };
+            double h=0.5;
+            int numSteps=(int)std::ceil(detail::TANH_SINH_MAX_T/h);
+            Result total=futilities::detail::parallel_sum(2*numSteps+1, [&](int k){
+                return term((k-numSteps)*h);
+            });
+            Result estimate=(Number)h*total;
+            for(int level=1; level<=detail::TANH_SINH_MAX_LEVEL; ++level){
+                h*=0.5;
+                numSteps*=2;
+                //only the odd multiples of the new step are new
+                total+=futilities::detail::parallel_sum(numSteps, [&](int k){
+                    return term((2*k+1-numSteps)*h);
+                });
+                const Result refined=(Number)h*total;
+                const Number change=std::abs(refined-estimate);
+                estimate=refined;
+                if(change<=tolerance*std::abs(refined)){
+                    break;
+                }
+            }
+            return estimate;
+        }
+
+        /**
+            @a lower bound
+            @b upper bound
+            @n number of intervals, at least one
+            @returns trapezoid rule
+        */
+        template<typename Number>
+        rule<Number> trapezoid_rule(const Number& a, const Number& b, int n){
+            n=std::max(n, 1);
+            rule<Number> result;
+            const Number h=(b-a)/(Number)n;
+            result.nodes=futilities::for_emplace_back_parallel(a, b, n+1);
+            result.weights.assign(n+1, h);
+            result.weights.front()=result.weights.back()=h*Number(0.5);
+            return result;
+        }
+        /**
+            @a lower bound
+            @b upper bound
+            @n number of intervals, rounded up to a positive even number
+            @returns Simpson rule
+        */
+        template<typename Number>
+        rule<Number> simpson_rule(const Number& a, const Number& b, int n){
+            n=std::max(n, 1);
+            n+=n%2;
+            rule<Number> result;
+            const Number h=(b-a)/(Number)n;
+            result.nodes=futilities::for_emplace_back_parallel(a, b, n+1);
+            result.weights.resize(n+1);
+            for(int i=0; i<=n; ++i){
+                result.weights[i]=h/Number(3)*(i==0||i==n?Number(1):i%2==1?Number(4):Number(2));
+            }
+            return result;
+        }
+        /**
+            @a lower bound
+            @b upper bound
+            @order nodes per panel
+            @numPanels number of equal panels [a, b] is split into
+            @returns composite Gauss-Legendre rule
+        */
+        template<typename Number>
+        rule<Number> gauss_legendre_rule(const Number& a, const Number& b, int order, int numPanels=1){
+            const auto base=get_gauss_legendre<Number>(order);
+            const Number halfWidth=(b-a)/(Number)(2*numPanels);
+            rule<Number> result;
+            result.nodes.resize(order*numPanels);
+            result.weights.resize(order*numPanels);
+            for(int panel=0; panel<numPanels; ++panel){
+                for(int j=0; j<order; ++j){
+                    result.nodes[panel*order+j]=a+halfWidth*((Number)(2*panel+1)+base->nodes[j]);
+                    result.weights[panel*order+j]=halfWidth*base->weights[j];
+                }
+            }
+            return result;
+        }
+        /**
+            @a lower bound
+            @b upper bound
+            @level the step is 2^-level
+            @returns tanh-sinh rule, without nodes that round to a or b
+        */
+        template<typename Number>
+        rule<Number> tanh_sinh_rule(const Number& a, const Number& b, int level){
+            const double h=std::ldexp(1.0, -level);
+            const int numSteps=(int)std::ceil(detail::TANH_SINH_MAX_T/h);
+            rule<Number> result;
+            for(int k=-numSteps; k<=numSteps; ++k){
+                Number x, weight;
+                detail::tanh_sinh_node(a, b, k*h, x, weight);
+                if(a<x&&x<b){
+                    result.nodes.push_back(x);
+                    result.weights.push_back((Number)h*weight);
+                }
+            }
+            return result;
+        }
+        /**
+            @quadratureRule nodes and weights
+            @fn integrand
+            @returns sum of weight*fn(node)
+        */
+        template<typename T, typename Function>
+        auto integrate(const rule<T>& quadratureRule, Function&& fn){
+            return futilities::weighted_sum(quadratureRule.weights, quadratureRule.nodes, [&](const auto& x, int){
+                return fn(x);
+            });
+        }
+        /**
+            Integrates fn(x, param) for every parameter with the same rule.  
+            Parameters run in parallel and nodes run in a simd reduction.  
+            This function runs in parallel when compiled with openmp enabled
+            @quadratureRule nodes and weights
+            @params array of parameters
+            @fn integrand taking (x, param)
+            @returns array of integrals, one per parameter
+        */
+        template<typename T, typename Params, typename Function>
+        auto integrate_batch(const rule<T>& quadratureRule, const Params& params, Function&& fn){
+            typedef std::decay_t<decltype(T(1)*fn(quadratureRule.nodes[0], params[0]))> Result;
+            typedef futilities::detail::block_sum<std::is_arithmetic<Result>::value> block;
+            const int numParams=params.size();
+            const int n=quadratureRule.size();
+            const T* nodes=quadratureRule.nodes.data();
+            const T* weights=quadratureRule.weights.data();
+            std::vector<Result> result(numParams);
+            #pragma omp parallel for
+            for(int p=0; p<numParams; ++p){
+                const auto& param=params[p];
+                auto term=[&](int i){
+                    return weights[i]*fn(nodes[i], param);
+                };
+                result[p]=block::template apply<Result>(0, n, term);
+            }
+            return result;
+        }
+        /**value, estimated absolute error and number of integrand calls*/
+        template<typename T>
+        struct quadrature_result{
+            T value;
+            T error;
+            int evaluations;
+        };
+        namespace detail{
+            /**Kronrod nodes of the 15 point rule on [0, 1], the odd ones are the Gauss nodes*/
+            constexpr double KRONROD_NODES[8]={
+                0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+                0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+                0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+                0.207784955007898467600689403773245, 0.0
+            };
+            constexpr double KRONROD_WEIGHTS[8]={
+                0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+                0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+                0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+                0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+            };
+            /**weights of the 7 point Gauss rule at KRONROD_NODES[1], [3], [5], [7]*/
+            constexpr double GAUSS_WEIGHTS[4]={
+                0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+                0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+            };
+            constexpr int KRONROD_POINTS=15;
+
+            template<typename T>
+            struct segment{
+                T a;
+                T b;
+                T value;
+                T error;
+                bool operator<(const segment& other) const{
+                    return error<other.error;
+                }
+            };
+            /**
+                Gauss-Kronrod 7-15 rule on [a, b] with the QUADPACK error 
+                estimate
+            */
+            template<typename T, typename Function>
+            segment<T> gauss_kronrod(const T& a, const T& b, Function& fn){
+                const T center=(a+b)*T(0.5);
+                const T halfLength=(b-a)*T(0.5);
+                T values[KRONROD_POINTS];
+                for(int j=0; j<7; ++j){
+                    const T offset=halfLength*(T)KRONROD_NODES[j];
+                    values[j]=fn(center-offset);
+                    values[KRONROD_POINTS-1-j]=fn(center+offset);
+                }
+                values[7]=fn(center);
+                T kronrod=T(0);
+                T gauss=T(0);
+                T absolute=T(0);
+                for(int j=0; j<KRONROD_POINTS; ++j){
+                    const int node=j<8?j:KRONROD_POINTS-1-j;
+                    kronrod+=(T)KRONROD_WEIGHTS[node]*values[j];
+                    absolute+=(T)KRONROD_WEIGHTS[node]*std::abs(values[j]);
+                    if(node%2==1){
+                        gauss+=(T)GAUSS_WEIGHTS[node/2]*values[j];
+                    }
+                }
+                const T mean=kronrod*T(0.5);
+                T deviation=T(0);
+                for(int j=0; j<KRONROD_POINTS; ++j){
+                    const int node=j<8?j:KRONROD_POINTS-1-j;
+                    deviation+=(T)KRONROD_WEIGHTS[node]*std::abs(values[j]-mean);
+                }
+                const T scale=std::abs(halfLength);
+                deviation*=scale;
+                absolute*=scale;
+                T error=std::abs((kronrod-gauss)*halfLength);
+                if(deviation!=T(0)&&error!=T(0)){
+                    error=deviation*std::min(T(1), std::pow(T(200)*error/deviation, T(1.5)));
+                }
+                const T epsilon=std::numeric_limits<T>::epsilon();
+                if(absolute>std::numeric_limits<T>::min()/(T(50)*epsilon)){
+                    error=std::max(T(50)*epsilon*absolute, error);
+                }
+                return segment<T>{a, b, kronrod*halfLength, error};
+            }
+        }
+        /**
+            Adaptive Gauss-Kronrod 7-15 integration.  Subintervals wait in 
+            a priority queue shared by all threads; each thread takes the 
+            one with the largest error, splits it in two and puts the 
+            halves back, until the summed error is below 
+            max(absoluteTolerance, relativeTolerance*|value|) or 
+            maxEvaluations is reached.  fn is only evaluated where the 
+            error is.  With several threads the intervals refined can 
+            differ from run to run, so the last digits can too.  fn is 
+            called from several threads when compiled with openmp enabled
+            @a lower bound
+            @b upper bound
+            @fn integrand
+            @absoluteTolerance global absolute error budget
+            @relativeTolerance global error budget relative to the integral
+            @maxEvaluations limit on integrand calls
+            @returns quadrature_result with the value, error and calls
+        */
+        template<typename Number, typename Function>
+        quadrature_result<Number> adaptive(
+            const Number& a, const Number& b, Function&& fn,
+            const Number& absoluteTolerance=Number(1e-10), const Number& relativeTolerance=Number(1e-10),
+            int maxEvaluations=1000000
+        ){
+            typedef detail::segment<Number> segment;
+            const segment whole=detail::gauss_kronrod(a, b, fn);
+            std::priority_queue<segment> queue;
+            //intervals too short to split keep their error but leave the queue
+            std::vector<segment> finished;
+            queue.push(whole);
+            Number value=whole.value;
+            Number error=whole.error;
+            int evaluations=detail::KRONROD_POINTS;
+            //evaluations reserved by threads splitting a segment, so maxEvaluations holds with several threads
+            int inFlight=0;
+            int active=0;
+            bool done=false;
+            std::mutex queueMutex;
+            std::condition_variable changed;
+            auto converged=[&](){
+                return error<=std::max(absoluteTolerance, relativeTolerance*std::abs(value))||
+                    evaluations+inFlight+2*detail::KRONROD_POINTS>maxEvaluations;
+            };
+            #pragma omp parallel
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                while(true){
+                    changed.wait(lock, [&](){
+                        return done||!queue.empty()||active==0;
+                    });
+                    if(done||queue.empty()||converged()){
+                        done=true;
+                        changed.notify_all();
+                        break;
+                    }
+                    const segment worst=queue.top();
+                    queue.pop();
+                    const Number middle=(worst.a+worst.b)*Number(0.5);
+                    const bool splittable=worst.a<middle&&middle<worst.b;
+                    const int reserved=splittable?2*detail::KRONROD_POINTS:0;
+                    inFlight+=reserved;
+                    ++active;
+                    lock.unlock();
+                    segment left=worst;
+                    segment right=worst;
+                    if(splittable){
+                        left=detail::gauss_kronrod(worst.a, middle, fn);
+                        right=detail::gauss_kronrod(middle, worst.b, fn);
+                    }
+                    lock.lock();
+                    --active;
+                    inFlight-=reserved;
+                    evaluations+=reserved;
+                    if(splittable){
+                        value+=left.value+right.value-worst.value;
+                        error+=left.error+right.error-worst.error;
+                        queue.push(left);
+                        queue.push(right);
+                    }
+                    else{
+                        finished.push_back(worst);
+                    }
+                    changed.notify_all();
+                }
+            }
+            //resum so the result does not carry the rounding of the updates
+            while(!queue.empty()){
+                finished.push_back(queue.top());
+                queue.pop();
+            }
+            std::sort(finished.begin(), finished.end(), [](const segment& x, const segment& y){
+                return x.a<y.a;
+            });
+            quadrature_result<Number> result{Number(0), Number(0), evaluations};
+            for(const auto& piece:finished){
+                result.value+=piece.value;
+                result.error+=piece.error;
+            }
+            return result;
+        }
+    }
+
+    /**
+        Counter-based random numbers.  A value is a pure function of 
+        (seed, stream, index, draw), computed with the Philox4x32-10 
+        block cipher, so lambdas given an index by for_each_parallel can 
+        draw their own numbers without shared state and results do not 
+        depend on the number of threads.
+    */
+    namespace random{
+        namespace detail{
+            constexpr std::uint32_t PHILOX_M0=0xD2511F53;
+            constexpr std::uint32_t PHILOX_M1=0xCD9E8D57;
+            constexpr std::uint32_t PHILOX_W0=0x9E3779B9;
+            constexpr std::uint32_t PHILOX_W1=0xBB67AE85;
+            constexpr int PHILOX_ROUNDS=10;
+            /**values generated together when filling arrays in parallel*/
+            constexpr int RANDOM_BLOCK_SIZE=1024;
+
+            FUTILITIES_ALWAYS_INLINE void philox_round(
+                std::uint32_t& c0, std::uint32_t& c1, std::uint32_t& c2, std::uint32_t& c3, 
+                std::uint32_t k0, std::uint32_t k1
+            ){
+                const std::uint64_t product0=(std::uint64_t)PHILOX_M0*c0;
+                const std::uint64_t product1=(std::uint64_t)PHILOX_M1*c2;
+                const std::uint32_t next0=(std::uint32_t)(product1>>32)^c1^k0;
+                const std::uint32_t next2=(std::uint32_t)(product0>>32)^c3^k1;
+                c1=(std::uint32_t)product1;
+                c3=(std::uint32_t)product0;
+                c0=next0;
+                c2=next2;
+            }
+            /**encrypts the counter in place*/
+            FUTILITIES_ALWAYS_INLINE void philox(
+                std::uint32_t& c0, std::uint32_t& c1, std::uint32_t& c2, std::uint32_t& c3, 
+                std::uint32_t k0, std::uint32_t k1
+            ){
+                for(int round=0; round<PHILOX_ROUNDS; ++round){
+                    philox_round(c0, c1, c2, c3, k0, k1);
+                    k0+=PHILOX_W0;
+                    k1+=PHILOX_W1;
+                }
+            }
+            /**
+                How words of a Philox block become uniforms in (0, 1):  a 
+                float takes 23 bits of one word and a double 52 bits of two, 
+                offset by half a step so neither end is reachable
+            */
+            template<typename T>
+            struct unit_traits;
+            template<>
+            struct unit_traits<float>{
+                static constexpr int per_block=4;
+                FUTILITIES_ALWAYS_INLINE static float convert(const std::uint32_t* words, int j){
+                    return (float)(std::int32_t)(words[j]>>9)*1.1920928955078125e-7f+5.9604644775390625e-8f;
+                }
+                /**writes every uniform of a block, unrolled so the loop over blocks vectorizes*/
+                FUTILITIES_ALWAYS_INLINE static void store(std::uint32_t w0, std::uint32_t w1, std::uint32_t w2, std::uint32_t w3, float* result){
+                    const std::uint32_t words[4]={w0, w1, w2, w3};
+                    result[0]=convert(words, 0);
+                    result[1]=convert(words, 1);
+                    result[2]=convert(words, 2);
+                    result[3]=convert(words, 3);
+                }
+            };
+            template<>
+            struct unit_traits<double>{
+                static constexpr int per_block=2;
+                //31 bits of one word and 21 of the other, through signed 
+                //conversions since unsigned ones do not vectorize before avx512
+                FUTILITIES_ALWAYS_INLINE static double convert(const std::uint32_t* words, int j){
+                    return (double)(std::int32_t)(words[2*j]>>1)*4.656612873077392578125e-10+
+                        (double)(std::int32_t)(words[2*j+1]>>11)*2.220446049250313080847263336181640625e-16+
+                        1.1102230246251565404236316680908203125e-16;
+                }
+                FUTILITIES_ALWAYS_INLINE static void store(std::uint32_t w0, std::uint32_t w1, std::uint32_t w2, std::uint32_t w3, double* result){
+                    const std::uint32_t words[4]={w0, w1, w2, w3};
+                    result[0]=convert(words, 0);
+                    result[1]=convert(words, 1);
+                }
+            };
+        }
+        /**
+            The Philox4x32-10 block function
+            @counter four 32 bit words
+            @key two 32 bit words
+            @returns encrypted counter
+        */
+        inline std::array<std::uint32_t, 4> philox4x32(const std::array<std::uint32_t, 4>& counter, const std::array<std::uint32_t, 2>& key){
+            std::array<std::uint32_t, 4> result=counter;
+            detail::philox(result[0], result[1], result[2], result[3], key[0], key[1]);
+            return result;
+        }
+        /**
+            Random numbers keyed on (seed, stream).  uniform(index, draw) 
+            and normal(index, draw) can be called in any order from any 
+            thread:  index is usually the index a lambda receives and draw 
+            counts the numbers one index needs, eg the steps of a path.  
+            Every Philox block gives two double or four float uniforms 
+            and the normals come from pairs of uniforms by Box-Muller, 
+            with the logarithms and sines of packs whether the normals 
+            are drawn one at a time or filled, so that both give the 
+            same bits.
+        */
+        class counter_rng{
+        public:
+            /**
+                @seed_ key of the generator
+                @stream_ independent stream for the same seed
+            */
+            explicit counter_rng(std::uint64_t seed_, std::uint32_t stream_=0):
+                key0((std::uint32_t)seed_), key1((std::uint32_t)(seed_>>32)), stream(stream_){}
+            /**
+                @index position in the stream, eg a path
+                @draw number within the index, eg a step
+                @returns uniform in (0, 1)
+            */
+            template<typename T=double>
+            T uniform(std::uint64_t index, std::uint32_t draw=0) const{
+                typedef detail::unit_traits<T> traits;
+                std::uint32_t words[4];
+                block(index, draw/traits::per_block, words);
+                return traits::convert(words, draw%traits::per_block);
+            }
+            /**
+                @index position in the stream, eg a path
+                @draw number within the index, eg a step
+                @returns standard normal
+            */
+            template<typename T=double>
+            T normal(std::uint64_t index, std::uint32_t draw=0) const{
+                typedef detail::unit_traits<T> traits;
+                //both uniforms of a pair come from the same block
+                const std::uint32_t first=draw-draw%2;
+                std::uint32_t words[4];
+                block(index, first/traits::per_block, words);
+                constexpr int W=simd_pack<T>::width;
+                T radius[W];
+                T angle[W];
+                T sines[W];
+                T cosines[W];
+                radius[0]=traits::convert(words, first%traits::per_block);
+                angle[0]=T(2*3.14159265358979323846)*traits::convert(words, first%traits::per_block+1);
+                box_muller(radius, angle, sines, cosines, 1);
+                return radius[0]*(draw%2==0?cosines[0]:sines[0]);
+            }
+            /**
+                Sets array[k]=uniform(index, firstDraw+k).  This function 
+                runs in parallel when compiled with openmp enabled
+                @array std-style contiguous container of float or double
+                @index position in the stream
+                @firstDraw draw of array[0]
+                @returns filled array
+            */
+            template<typename Array>
+            auto fill_uniform(Array&& array, std::uint64_t index=0, int firstDraw=0) const{
+                typedef std::decay_t<decltype(array[0])> T;
+                const int n=array.size();
+                T* data=array.data();
+                #pragma omp parallel for if(n>detail::RANDOM_BLOCK_SIZE)
+                for(int begin=0; begin<n; begin+=detail::RANDOM_BLOCK_SIZE){
+                    const int end=std::min(begin+detail::RANDOM_BLOCK_SIZE, n);
+                    fill_uniform_block(data+begin, firstDraw+begin, firstDraw+end, index);
+                }
+                return std::move(array);
+            }
+            /**
+                Sets array[k]=normal(index, firstDraw+k), bit for bit.  
+                This function runs in parallel when compiled with openmp 
+                enabled
+                @array std-style contiguous container of float or double
+                @index position in the stream
+                @firstDraw draw of array[0]
+                @returns filled array
+            */
+            template<typename Array>
+            auto fill_normal(Array&& array, std::uint64_t index=0, int firstDraw=0) const{
+                typedef std::decay_t<decltype(array[0])> T;
+                typedef simd_pack<T> pack;
+                constexpr int blockSize=detail::RANDOM_BLOCK_SIZE;
+                const int n=array.size();
+                T* data=array.data();
+                #pragma omp parallel for if(n>blockSize)
+                for(int begin=0; begin<n; begin+=blockSize){
+                    const int drawBegin=firstDraw+begin;
+                    const int drawEnd=firstDraw+std::min(begin+blockSize, n);
+                    //uniforms for the pairs this block touches, rounded out to whole pairs
+                    const int pairBegin=drawBegin/2;
+                    const int numPairs=(drawEnd+1)/2-pairBegin;
+                    T uniforms[blockSize+2];
+                    fill_uniform_block(uniforms, 2*pairBegin, 2*(pairBegin+numPairs), index);
+                    T radius[blockSize/2+pack::width];
+                    T angle[blockSize/2+pack::width];
+                    FUTILITIES_OMP_SIMD
+                    for(int j=0; j<numPairs; ++j){
+                        radius[j]=uniforms[2*j];
+                        angle[j]=T(2*3.14159265358979323846)*uniforms[2*j+1];
+                    }
+                    T sines[blockSize/2+pack::width];
+                    T cosines[blockSize/2+pack::width];
+                    box_muller(radius, angle, sines, cosines, numPairs);
+                    for(int draw=drawBegin; draw<drawEnd; ++draw){
+                        const int pair=draw/2-pairBegin;
+                        data[draw-firstDraw]=radius[pair]*(draw%2==0?cosines[pair]:sines[pair]);
+                    }
+                }
+                return std::move(array);
+            }
+            /**
+                Sets result[k*stride+i]=normal(firstIndex+i, firstDraw+k), 
+                bit for bit, so the draws of consecutive indices lie side by side, eg 
+                the increments of a block of paths step after step.  The 
+                Philox blocks and Box-Muller run across the indices with 
+                packs
+                @result destination
+                @stride distance between the draws of one index
+                @firstIndex index of result[0]
+                @numIndices number of indices
+                @firstDraw draw of result[0]
+                @numDraws number of draws per index
+            */
+            template<typename T>
+            void fill_normal_indices(T* result, int stride, std::uint64_t firstIndex, int numIndices, int firstDraw, int numDraws) const{
+                typedef detail::unit_traits<T> traits;
+                typedef simd_pack<T> pack;
+                constexpr int perBlock=traits::per_block;
+                constexpr int chunkSize=detail::RANDOM_BLOCK_SIZE/perBlock;
+                const int drawEnd=firstDraw+numDraws;
+                const std::uint32_t k0=key0;
+                const std::uint32_t k1=key1;
+                const std::uint32_t s=stream;
+                for(int chunk=0; chunk<numIndices; chunk+=chunkSize){
+                    const int m=std::min(chunkSize, numIndices-chunk);
+                    T values[chunkSize*perBlock];
+                    T radius[chunkSize+pack::width];
+                    T angle[chunkSize+pack::width];
+                    T sines[chunkSize+pack::width];
+                    T cosines[chunkSize+pack::width];
+                    for(int b=firstDraw/perBlock; b*perBlock<drawEnd; ++b){
+                        FUTILITIES_OMP_SIMD
+                        for(int i=0; i<m; ++i){
+                            const std::uint64_t index=firstIndex+chunk+i;
+                            std::uint32_t c0=b;
+                            std::uint32_t c1=(std::uint32_t)index;
+                            std::uint32_t c2=(std::uint32_t)(index>>32);
+                            std::uint32_t c3=s;
+                            detail::philox(c0, c1, c2, c3, k0, k1);
+                            traits::store(c0, c1, c2, c3, values+i*perBlock);
+                        }
+                        //every block holds whole Box-Muller pairs
+                        for(int pair=0; pair<perBlock/2; ++pair){
+                            const int draw=b*perBlock+2*pair;
+                            if(draw+1<firstDraw||draw>=drawEnd){
+                                continue;
+                            }
+                            for(int i=0; i<m; ++i){
+                                radius[i]=values[i*perBlock+2*pair];
+                                angle[i]=T(2*3.14159265358979323846)*values[i*perBlock+2*pair+1];
+                            }
+                            box_muller(radius, angle, sines, cosines, m);
+                            if(draw>=firstDraw){
+                                T* row=result+(draw-firstDraw)*stride+chunk;
+                                FUTILITIES_OMP_SIMD
+                                for(int i=0; i<m; ++i){
+                                    row[i]=radius[i]*cosines[i];
+                                }
+                            }
+                            if(draw+1<drawEnd){
+                                T* row=result+(draw+1-firstDraw)*stride+chunk;
+                                FUTILITIES_OMP_SIMD
+                                for(int i=0; i<m; ++i){
+                                    row[i]=radius[i]*sines[i];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        private:
+            std::uint32_t key0;
+            std::uint32_t key1;
+            std::uint32_t stream;
+
+            FUTILITIES_ALWAYS_INLINE void block(std::uint64_t index, std::uint32_t counter, std::uint32_t* words) const{
+                words[0]=counter;
+                words[1]=(std::uint32_t)index;
+                words[2]=(std::uint32_t)(index>>32);
+                words[3]=stream;
+                detail::philox(words[0], words[1], words[2], words[3], key0, key1);
+            }
+            /**
+                Sets radius[j]=sqrt(-2log(radius[j])) and the sine and 
+                cosine of angle[j] for j<n, a whole pack at a time 
+                including the last, so that every normal comes from the 
+                same code whatever its lane.  The arrays hold n rounded 
+                up to whole packs
+            */
+            template<typename T>
+            static void box_muller(T* radius, T* angle, T* sines, T* cosines, int n){
+                typedef simd_pack<T> pack;
+                const int end=(n+pack::width-1)/pack::width*pack::width;
+                for(int j=n; j<end; ++j){
+                    radius[j]=T(1);
+                    angle[j]=T(0);
+                }
+                for(int j=0; j<end; j+=pack::width){
+                    math::log(pack::load(radius+j)).store(radius+j);
+                    const auto sinCos=math::sincos(pack::load(angle+j));
+                    sinCos.first.store(sines+j);
+                    sinCos.second.store(cosines+j);
+                }
+                FUTILITIES_OMP_SIMD
+                for(int j=0; j<n; ++j){
+                    radius[j]=std::sqrt(T(-2)*radius[j]);
+                }
+            }
+            /**writes uniform(index, k) to result[k-begin] for k in [begin, end)*/
+            template<typename T>
+            void fill_uniform_block(T* result, int begin, int end, std::uint64_t index) const{
+                typedef detail::unit_traits<T> traits;
+                constexpr int perBlock=traits::per_block;
+                const int firstBlock=begin/perBlock;
+                const int lastBlock=(end+perBlock-1)/perBlock;
+                T values[detail::RANDOM_BLOCK_SIZE+2*perBlock];
+                const std::uint32_t indexLow=(std::uint32_t)index;
+                const std::uint32_t indexHigh=(std::uint32_t)(index>>32);
+                const std::uint32_t k0=key0;
+                const std::uint32_t k1=key1;
+                const std::uint32_t s=stream;
+                FUTILITIES_OMP_SIMD
+                for(int b=firstBlock; b<lastBlock; ++b){
+                    //scalars rather than an array, which gcc would keep in memory
+                    std::uint32_t c0=b;
+                    std::uint32_t c1=indexLow;
+                    std::uint32_t c2=indexHigh;
+                    std::uint32_t c3=s;
+                    detail::philox(c0, c1, c2, c3, k0, k1);
+                    traits::store(c0, c1, c2, c3, values+(b-firstBlock)*perBlock);
+                }
+                std::copy(values+(begin-firstBlock*perBlock), values+(end-firstBlock*perBlock), result);
+            }
+        };
+    }
+
+    /**
+        Monte Carlo driver that keeps running statistics of the samples 
+        instead of storing them.  Paths are split into fixed blocks, each 
+        block gets its own Welford accumulator, and the blocks are merged 
+        in order, so the result does not depend on the number of threads.
+    */
+    namespace monte_carlo{
+        namespace detail{
+            /**paths per accumulator*/
+            constexpr long long MONTE_CARLO_BLOCK_SIZE=4096;
+            /**paths run between checks of the standard error by default*/
+            constexpr long long MONTE_CARLO_BATCH_SIZE=1<<18;
+            /**samples accumulate in their own type when it is floating point and in double otherwise, eg for hit counts*/
+            template<typename Sample>
+            using accumulator_type=std::conditional_t<std::is_floating_point<Sample>::value, Sample, double>;
+        }
+        /**
+            Streaming mean and central moments (Welford's update, with 
+            Terriberry's extension to the third and fourth moments when 
+            Order is 4) and Chan/Pebay merging of two accumulators
+        */
+        template<typename T, int Order=2>
+        struct statistics{
+            static_assert(Order==2||Order==4, "statistics tracks two or four moments");
+            static_assert(std::is_floating_point<T>::value, "statistics accumulates in a floating point type");
+            long long count=0;
+            T mean=T(0);
+            /**sums of the second, third and fourth powers of the deviations*/
+            T m2=T(0);
+            T m3=T(0);
+            T m4=T(0);
+            void add(const T& x){
+                const T previous=(T)count;
+                ++count;
+                const T n=(T)count;
+                const T delta=x-mean;
+                const T deltaN=delta/n;
+                const T term=delta*deltaN*previous;
+                mean+=deltaN;
+                if(Order==4){
+                    const T deltaN2=deltaN*deltaN;
+                    m4+=term*deltaN2*(n*n-T(3)*n+T(3))+T(6)*deltaN2*m2-T(4)*deltaN*m3;
+                    m3+=term*deltaN*(n-T(2))-T(3)*deltaN*m2;
+                }
+                m2+=term;
+            }
+            void merge(const statistics& other){
+                if(other.count==0){
+                    return;
+                }
+                if(count==0){
+                    *this=other;
+                    return;
+                }
+                const T na=(T)count;
+                const T nb=(T)other.count;
+                const T n=na+nb;
+                const T delta=other.mean-mean;
+                const T delta2=delta*delta;
+                if(Order==4){
+                    m4+=other.m4+delta2*delta2*na*nb*(na*na-na*nb+nb*nb)/(n*n*n)+
+                        T(6)*delta2*(na*na*other.m2+nb*nb*m2)/(n*n)+T(4)*delta*(na*other.m3-nb*m3)/n;
+                    m3+=other.m3+delta2*delta*na*nb*(na-nb)/(n*n)+T(3)*delta*(na*other.m2-nb*m2)/n;
+                }
+                m2+=other.m2+delta2*na*nb/n;
+                mean+=delta*nb/n;
+                count+=other.count;
+            }
+            /**sample variance*/
+            T variance() const{
+                return count>1?m2/(T)(count-1):T(0);
+            }
+            /**standard error of the mean*/
+            T standard_error() const{
+                return count>1?std::sqrt(variance()/(T)count):std::numeric_limits<T>::infinity();
+            }
+            /**population skewness, needs Order 4*/
+            T skewness() const{
+                static_assert(Order==4, "skewness needs statistics<T, 4>");
+                return std::sqrt((T)count)*m3/std::pow(m2, T(1.5));
+            }
+            /**population excess kurtosis, needs Order 4*/
+            T excess_kurtosis() const{
+                static_assert(Order==4, "excess_kurtosis needs statistics<T, 4>");
+                return (T)count*m4/(m2*m2)-T(3);
+            }
+        };
+        namespace detail{
+            /**
+                Runs paths [begin, end) in fixed blocks in parallel and 
+                merges the blocks in order into result
+            */
+            template<typename Statistics, typename Function>
+            void run_paths(long long begin, long long end, Function& fn, Statistics& result){
+                const long long numBlocks=(end-begin+MONTE_CARLO_BLOCK_SIZE-1)/MONTE_CARLO_BLOCK_SIZE;
+                std::vector<Statistics> partial(numBlocks);
+                #pragma omp parallel for schedule(dynamic)
+                for(long long block=0; block<numBlocks; ++block){
+                    const long long blockBegin=begin+block*MONTE_CARLO_BLOCK_SIZE;
+                    const long long blockEnd=std::min(blockBegin+MONTE_CARLO_BLOCK_SIZE, end);
+                    Statistics& local=partial[block];
+                    for(long long path=blockBegin; path<blockEnd; ++path){
+                        local.add(fn(path));
+                    }
+                }
+                for(const auto& blockStatistics:partial){
+                    result.merge(blockStatistics);
+                }
+            }
+        }
+        /**
+            Runs fn(path) for every path without storing the samples.  
+            This function runs in parallel when compiled with openmp enabled
+            @numPaths number of paths
+            @fn function of the path index returning a sample, eg a 
+            discounted payoff drawn with random::counter_rng; integer 
+            samples are accumulated as double
+            @returns statistics of the samples
+        */
+        template<int Order=2, typename Function>
+        auto simulate(long long numPaths, Function&& fn){
+            typedef detail::accumulator_type<std::decay_t<decltype(fn(0LL))>> T;
+            statistics<T, Order> result;
+            detail::run_paths(0, numPaths, fn, result);
+            return result;
+        }
+        /**
+            Runs batches of paths until the standard error of the mean is 
+            at most standardError or maxPaths have run.  The batches are 
+            fixed, so the stopping point does not depend on the number of 
+            threads.  This function runs in parallel when compiled with 
+            openmp enabled
+            @standardError target standard error of the mean
+            @maxPaths most paths to run
+            @fn function of the path index returning a sample
+            @batchSize paths between checks
+            @returns statistics of the samples
+        */
+        template<int Order=2, typename Number, typename Function>
+        auto simulate_until(const Number& standardError, long long maxPaths, Function&& fn, long long batchSize=detail::MONTE_CARLO_BATCH_SIZE){
+            typedef detail::accumulator_type<std::decay_t<decltype(fn(0LL))>> T;
+            statistics<T, Order> result;
+            for(long long begin=0; begin<maxPaths; begin+=batchSize){
+                detail::run_paths(begin, std::min(begin+batchSize, maxPaths), fn, result);
+                if(result.standard_error()<=standardError){
+                    break;
+                }
+            }
+            return result;
+        }
+    }
+
+    /**
+        Simulation of dX=drift(X, t)dt+diffusion(X, t)dW for many paths.  
+        Paths are stored as lanes (one array of states per block of 
+        paths) and every time step advances the whole block in a simd 
+        loop, with blocks running in parallel.  The Brownian increment of 
+        path p at step s is sqrt(dt)*rng.normal(p, s), so results do not 
+        depend on the blocking or the number of threads.  Only the 
+        current state and an optional running statistic are kept per 
+        path.
+    */
+    namespace sde{
+        namespace detail{
+            /**paths advanced together*/
+            constexpr int SDE_BLOCK_SIZE=512;
+            /**steps whose increments are drawn at once for every path of a block*/
+            constexpr int SDE_STEP_CHUNK=32;
+
+            /**leaves the running statistic alone*/
+            struct no_statistic{
+                template<typename T>
+                T operator()(const T& running, const T&, int) const{
+                    return running;
+                }
+            };
+            template<bool Milstein>
+            struct scheme;
+            template<>
+            struct scheme<false>{
+                template<typename T, typename Drift, typename Diffusion, typename Derivative>
+                FUTILITIES_ALWAYS_INLINE static T step(const T& x, const T& t, const T& dt, const T& dw, Drift& drift, Diffusion& diffusion, Derivative&){
+                    return x+drift(x, t)*dt+diffusion(x, t)*dw;
+                }
+            };
+            template<>
+            struct scheme<true>{
+                template<typename T, typename Drift, typename Diffusion, typename Derivative>
+                FUTILITIES_ALWAYS_INLINE static T step(const T& x, const T& t, const T& dt, const T& dw, Drift& drift, Diffusion& diffusion, Derivative& derivative){
+                    const T volatility=diffusion(x, t);
+                    return x+drift(x, t)*dt+volatility*dw+T(0.5)*volatility*derivative(x, t)*(dw*dw-dt);
+                }
+            };
+            template<bool Milstein, typename T, typename Drift, typename Diffusion, typename Derivative, typename Statistic>
+            std::pair<std::vector<T>, std::vector<T>> simulate(
+                const T& x0, const T& t, int numSteps, int numPaths, 
+                Drift& drift, Diffusion& diffusion, Derivative& derivative, 
+                const random::counter_rng& rng, Statistic& statistic
+            ){
+                std::vector<T> terminal(numPaths);
+                std::vector<T> running(numPaths);
+                const T dt=t/(T)numSteps;
+                const T sqrtDt=std::sqrt(dt);
+                #pragma omp parallel for
+                for(int begin=0; begin<numPaths; begin+=SDE_BLOCK_SIZE){
+                    const int m=std::min(SDE_BLOCK_SIZE, numPaths-begin);
+                    T* x=terminal.data()+begin;
+                    T* stat=running.data()+begin;
+                    //increments of a chunk of steps, step after step, so the paths vectorize
+                    std::vector<T> dw(SDE_STEP_CHUNK*m);
+                    for(int i=0; i<m; ++i){
+                        x[i]=x0;
+                        stat[i]=x0;
+                    }
+                    for(int chunk=0; chunk<numSteps; chunk+=SDE_STEP_CHUNK){
+                        const int numChunkSteps=std::min(SDE_STEP_CHUNK, numSteps-chunk);
+                        //path p's step s is rng.normal(p, s)
+                        rng.fill_normal_indices(dw.data(), m, begin, m, chunk, numChunkSteps);
+                        for(int k=0; k<numChunkSteps; ++k){
+                            const int s=chunk+k;
+                            const T time=dt*(T)s;
+                            const T* increments=dw.data()+k*m;
+                            FUTILITIES_OMP_SIMD
+                            for(int i=0; i<m; ++i){
+                                x[i]=scheme<Milstein>::step(x[i], time, dt, sqrtDt*increments[i], drift, diffusion, derivative);
+                                stat[i]=statistic(stat[i], x[i], s+1);
+                            }
+                        }
+                    }
+                }
+                return std::make_pair(std::move(terminal), std::move(running));
+            }
+        }
+        /**
+            Euler-Maruyama simulation.  This function runs in parallel 
+            when compiled with openmp enabled
+            @x0 initial state of every path
+            @t horizon
+            @numSteps number of equal time steps
+            @numPaths number of paths
+            @drift function of (x, t)
+            @diffusion function of (x, t)
+            @rng generator for the Brownian increments; step s of path p uses rng.normal(p, s)
+            @returns state of every path at t
+        */
+        template<typename Number, typename Drift, typename Diffusion>
+        std::vector<Number> euler(const Number& x0, const Number& t, int numSteps, int numPaths, Drift&& drift, Diffusion&& diffusion, const random::counter_rng& rng){
+            detail::no_statistic statistic;
+            return detail::simulate<false>(x0, t, numSteps, numPaths, drift, diffusion, diffusion, rng, statistic).first;
+        }
+        /**
+            Euler-Maruyama simulation with a path dependent statistic.  
+            The statistic starts at x0 and is updated after every step, 
+            eg [](const auto& running, const auto& x, int step){return std::max(running, x);} 
+            for the maximum or running+x for the sum of the path.  This 
+            function runs in parallel when compiled with openmp enabled
+            @x0 initial state of every path
+            @t horizon
+            @numSteps number of equal time steps
+            @numPaths number of paths
+            @drift function of (x, t)
+            @diffusion function of (x, t)
+            @rng generator for the Brownian increments; step s of path p uses rng.normal(p, s)
+            @statistic function of (running, x, step) returning the new running value
+            @returns pair of the states at t and the statistics of every path
+        */
+        template<typename Number, typename Drift, typename Diffusion, typename Statistic>
+        std::pair<std::vector<Number>, std::vector<Number>> euler(const Number& x0, const Number& t, int numSteps, int numPaths, Drift&& drift, Diffusion&& diffusion, const random::counter_rng& rng, Statistic&& statistic){
+            return detail::simulate<false>(x0, t, numSteps, numPaths, drift, diffusion, diffusion, rng, statistic);
+        }
+        /**
+            Milstein simulation, strong order one for scalar SDEs.  This 
+            function runs in parallel when compiled with openmp enabled
+            @x0 initial state of every path
+            @t horizon
+            @numSteps number of equal time steps
+            @numPaths number of paths
+            @drift function of (x, t)
+            @diffusion function of (x, t)
+            @diffusionDerivative derivative of diffusion with respect to x, function of (x, t)
+            @rng generator for the Brownian increments; step s of path p uses rng.normal(p, s)
+            @returns state of every path at t
+        */
+        template<typename Number, typename Drift, typename Diffusion, typename Derivative>
+        std::vector<Number> milstein(const Number& x0, const Number& t, int numSteps, int numPaths, Drift&& drift, Diffusion&& diffusion, Derivative&& diffusionDerivative, const random::counter_rng& rng){
+            detail::no_statistic statistic;
+            return detail::simulate<true>(x0, t, numSteps, numPaths, drift, diffusion, diffusionDerivative, rng, statistic).first;
+        }
+        /**
+            Milstein simulation with a path dependent statistic, see euler.  
+            This function runs in parallel when compiled with openmp enabled
+            @x0 initial state of every path
+            @t horizon
+            @numSteps number of equal time steps
+            @numPaths number of paths
+            @drift function of (x, t)
+            @diffusion function of (x, t)
+            @diffusionDerivative derivative of diffusion with respect to x, function of (x, t)
+            @rng generator for the Brownian increments; step s of path p uses rng.normal(p, s)
+            @statistic function of (running, x, step) returning the new running value
+            @returns pair of the states at t and the statistics of every path
+        */
+        template<typename Number, typename Drift, typename Diffusion, typename Derivative, typename Statistic>
+        std::pair<std::vector<Number>, std::vector<Number>> milstein(const Number& x0, const Number& t, int numSteps, int numPaths, Drift&& drift, Diffusion&& diffusion, Derivative&& diffusionDerivative, const random::counter_rng& rng, Statistic&& statistic){
+            return detail::simulate<true>(x0, t, numSteps, numPaths, drift, diffusion, diffusionDerivative, rng, statistic);
+        }
+    }
+
+    /**
+        Explicit Runge-Kutta integration of dy/dt=system(y, t).  Single 
+        systems use stage buffers allocated once per call and update the 
+        state in place.  Batches of small systems of fixed dimension are 
+        stored by component (y[j*numSystems+i] is component j of system 
+        i), so every stage is one simd loop across systems, with blocks 
+        of systems running in parallel.
+    */
+    namespace ode{
+        /**final state, time reached and number of accepted and rejected steps*/
+        template<typename Array, typename T>
+        struct ode_result{
+            Array state;
+            T time;
+            int accepted;
+            int rejected;
+        };
+        namespace detail{
+            /**systems advanced together in the batched integrators*/
+            constexpr int ODE_BLOCK_SIZE=256;
+            /**Dormand-Prince tableau*/
+            constexpr double DP_C[7]={0.0, 1.0/5.0, 3.0/10.0, 4.0/5.0, 8.0/9.0, 1.0, 1.0};
+            constexpr double DP_A[7][6]={
+                {0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+                {1.0/5.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+                {3.0/40.0, 9.0/40.0, 0.0, 0.0, 0.0, 0.0},
+                {44.0/45.0, -56.0/15.0, 32.0/9.0, 0.0, 0.0, 0.0},
+                {19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0, 0.0, 0.0},
+                {9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0, 0.0},
+                {35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0}
+            };
+            /**difference between the fifth and fourth order weights*/
+            constexpr double DP_E[7]={71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0, 22.0/525.0, -1.0/40.0};
+            constexpr double SAFETY=0.9;
+            constexpr double MIN_FACTOR=0.2;
+            constexpr double MAX_FACTOR=5.0;
+
+            /**factor to scale the step by given the scaled error norm, for scalars or packs*/
+            template<typename V>
+            FUTILITIES_ALWAYS_INLINE V step_factor(const V& error){
+                using std::min;
+                using std::max;
+                //error^(-1/5), bounded below so that exact steps stay finite
+                const V factor=V(SAFETY)*math::exp(V(-0.2)*math::log(max(error, V(1e-10))));
+                return min(V(MAX_FACTOR), max(V(MIN_FACTOR), factor));
+            }
+            /**scaled error contribution of one component*/
+            template<typename T>
+            FUTILITIES_ALWAYS_INLINE T scaled_error(const T& error, const T& y, const T& yNew, const T& absTol, const T& relTol){
+                const T scale=absTol+relTol*std::max(std::abs(y), std::abs(yNew));
+                return (error/scale)*(error/scale);
+            }
+        }
+        /**
+            Classical fourth order Runge-Kutta with a fixed step
+            @y initial state, std-style container
+            @t0 initial time
+            @t1 final time
+            @numSteps number of equal steps
+            @system function of (y, t, dydt) writing the derivative into dydt
+            @returns state at t1
+        */
+        template<typename Array, typename T, typename System>
+        auto rk4(Array&& y, const T& t0, const T& t1, int numSteps, System&& system){
+            typedef std::decay_t<Array> State;
+            const int n=y.size();
+            const T h=(t1-t0)/(T)numSteps;
+            State k1(y), k2(y), k3(y), k4(y), stage(y);
+            for(int s=0; s<numSteps; ++s){
+                const T t=t0+h*(T)s;
+                system(y, t, k1);
+                for(int j=0; j<n; ++j){
+                    stage[j]=y[j]+T(0.5)*h*k1[j];
+                }
+                system(stage, t+T(0.5)*h, k2);
+                for(int j=0; j<n; ++j){
+                    stage[j]=y[j]+T(0.5)*h*k2[j];
+                }
+                system(stage, t+T(0.5)*h, k3);
+                for(int j=0; j<n; ++j){
+                    stage[j]=y[j]+h*k3[j];
+                }
+                system(stage, t+h, k4);
+                for(int j=0; j<n; ++j){
+                    y[j]+=h*(k1[j]+T(2)*(k2[j]+k3[j])+k4[j])/T(6);
+                }
+            }
+            return std::move(y);
+        }
+        /**
+            Adaptive Dormand-Prince 5(4) with the error controlled per 
+            step by absTol+relTol*|y| in the root mean square norm
+            @y initial state, std-style container
+            @t0 initial time
+            @t1 final time, greater than t0
+            @system function of (y, t, dydt) writing the derivative into dydt
+            @absTol absolute tolerance
+            @relTol relative tolerance
+            @maxSteps maximum number of attempted steps
+            @returns ode_result with the state at time, which is t1 unless maxSteps ran out
+        */
+        template<typename Array, typename T, typename System>
+        auto dormand_prince(Array&& y, const T& t0, const T& t1, System&& system, const T& absTol=1e-8, const T& relTol=1e-8, int maxSteps=100000){
+            typedef std::decay_t<Array> State;
+            const int n=y.size();
+            std::vector<State> k(7, State(y));
+            State stage(y);
+            State error(y);
+            T t=t0;
+            system(y, t, k[0]);
+            //starting step from the size of the state and its derivative
+            T yNorm=0;
+            T dyNorm=0;
+            for(int j=0; j<n; ++j){
+                const T scale=absTol+relTol*std::abs(y[j]);
+                yNorm+=(y[j]/scale)*(y[j]/scale);
+                dyNorm+=(k[0][j]/scale)*(k[0][j]/scale);
+            }
+            T h=(yNorm<T(1e-10)||dyNorm<T(1e-10))?T(1e-6):T(0.01)*std::sqrt(yNorm/dyNorm);
+            h=std::min(h, t1-t0);
+            int accepted=0;
+            int rejected=0;
+            while(t<t1&&accepted+rejected<maxSteps){
+                const bool last=h>=t1-t;
+                if(last){
+                    h=t1-t;
+                }
+                for(int s=1; s<7; ++s){
+                    for(int j=0; j<n; ++j){
+                        T increment=0;
+                        for(int r=0; r<s; ++r){
+                            increment+=T(detail::DP_A[s][r])*k[r][j];
+                        }
+                        stage[j]=y[j]+h*increment;
+                    }
+                    system(stage, t+T(detail::DP_C[s])*h, k[s]);
+                }
+                //the last stage is evaluated at the new state
+                T norm=0;
+                for(int j=0; j<n; ++j){
+                    T estimate=0;
+                    for(int s=0; s<7; ++s){
+                        estimate+=T(detail::DP_E[s])*k[s][j];
+                    }
+                    norm+=detail::scaled_error(h*estimate, y[j], stage[j], absTol, relTol);
+                }
+                norm=std::sqrt(norm/(T)n);
+                if(norm<=T(1)){
+                    ++accepted;
+                    t=last?t1:t+h;
+                    std::swap(y, stage);
+                    std::swap(k[0], k[6]);
+                    h*=detail::step_factor(norm);
+                }
+                else{
+                    ++rejected;
+                    h*=std::min(T(1), detail::step_factor(norm));
+                }
+            }
+            return ode_result<State, T>{std::move(y), t, accepted, rejected};
+        }
+        namespace detail{
+            /**loads and stores one lane group: a simd_pack or a scalar*/
+            template<typename V>
+            struct lane_io{
+                FUTILITIES_ALWAYS_INLINE static V load(const V* source){
+                    return *source;
+                }
+                FUTILITIES_ALWAYS_INLINE static void store(const V& value, V* destination){
+                    *destination=value;
+                }
+                /**1 where a<=b and 0 elsewhere*/
+                FUTILITIES_ALWAYS_INLINE static V less_equal(const V& a, const V& b){
+                    return a<=b?V(1):V(0);
+                }
+                FUTILITIES_ALWAYS_INLINE static V total(const V& x){
+                    return x;
+                }
+                /**a where condition is 1 and b elsewhere, without touching the other value*/
+                FUTILITIES_ALWAYS_INLINE static V select(const V& condition, const V& a, const V& b){
+                    return condition!=V(0)?a:b;
+                }
+            };
+            template<typename T, int W>
+            struct lane_io<simd_pack<T, W>>{
+                typedef simd_pack<T, W> pack;
+                FUTILITIES_ALWAYS_INLINE static pack load(const T* source){
+                    return pack::load(source);
+                }
+                FUTILITIES_ALWAYS_INLINE static void store(const pack& value, T* destination){
+                    value.store(destination);
+                }
+                FUTILITIES_ALWAYS_INLINE static pack less_equal(const pack& a, const pack& b){
+                    return a.zip(b, [](const T& x, const T& y){return x<=y?T(1):T(0);});
+                }
+                FUTILITIES_ALWAYS_INLINE static T total(const pack& x){
+                    return horizontal_sum(x);
+                }
+                FUTILITIES_ALWAYS_INLINE static pack select(const pack& condition, const pack& a, const pack& b){
+                    pack result;
+                    for(int i=0; i<W; ++i){
+                        result[i]=condition[i]!=T(0)?a[i]:b[i];
+                    }
+                    return result;
+                }
+            };
+            /**batches without parameters*/
+            struct no_parameters{
+                template<typename V, typename T>
+                FUTILITIES_ALWAYS_INLINE V load(int) const{
+                    return V(T(0));
+                }
+            };
+            /**one parameter per system*/
+            template<typename T>
+            struct parameter_array{
+                const T* data;
+                template<typename V, typename U>
+                FUTILITIES_ALWAYS_INLINE V load(int i) const{
+                    return lane_io<V>::load(data+i);
+                }
+            };
+            /**
+                Classical Runge-Kutta step of the systems at lanes i of a 
+                block, component j at data[j*stride+i]
+            */
+            template<int Dim, typename V, typename T, typename Parameters, typename System>
+            FUTILITIES_ALWAYS_INLINE void rk4_lanes(T* data, int stride, int i, const Parameters& parameters, const T& t, const T& h, System& system){
+                typedef lane_io<V> io;
+                typedef std::array<V, Dim> vector;
+                const V p=parameters.template load<V, T>(i);
+                vector y, stage;
+                for(int j=0; j<Dim; ++j){
+                    y[j]=io::load(data+j*stride+i);
+                }
+                const vector k1=system(y, t, p);
+                for(int j=0; j<Dim; ++j){
+                    stage[j]=y[j]+T(0.5)*h*k1[j];
+                }
+                const vector k2=system(stage, t+T(0.5)*h, p);
+                for(int j=0; j<Dim; ++j){
+                    stage[j]=y[j]+T(0.5)*h*k2[j];
+                }
+                const vector k3=system(stage, t+T(0.5)*h, p);
+                for(int j=0; j<Dim; ++j){
+                    stage[j]=y[j]+h*k3[j];
+                }
+                const vector k4=system(stage, t+h, p);
+                for(int j=0; j<Dim; ++j){
+                    io::store(y[j]+h*(k1[j]+T(2)*(k2[j]+k3[j])+k4[j])/T(6), data+j*stride+i);
+                }
+            }
+            template<int Dim, typename T, typename Parameters, typename System>
+            void rk4_batch(T* data, int numSystems, const Parameters& parameters, const T& t0, const T& t1, int numSteps, System& system){
+                typedef simd_pack<T> pack;
+                const T h=(t1-t0)/(T)numSteps;
+                #pragma omp parallel for
+                for(int begin=0; begin<numSystems; begin+=ODE_BLOCK_SIZE){
+                    const int end=std::min(begin+ODE_BLOCK_SIZE, numSystems);
+                    for(int s=0; s<numSteps; ++s){
+                        const T t=t0+h*(T)s;
+                        int i=begin;
+                        for(; i+pack::width<=end; i+=pack::width){
+                            rk4_lanes<Dim, pack>(data, numSystems, i, parameters, t, h, system);
+                        }
+                        for(; i<end; ++i){
+                            rk4_lanes<Dim, T>(data, numSystems, i, parameters, t, h, system);
+                        }
+                    }
+                }
+            }
+            /**
+                One attempted Dormand-Prince step of the systems at lanes i 
+                of a block.  Lanes whose step is rejected keep their state 
+                and shrink their step; finished lanes take zero steps, 
+                which are always accepted.  Returns the number of lanes 
+                still short of t1.
+            */
+            template<int Dim, typename V, typename T, typename Parameters, typename System>
+            FUTILITIES_ALWAYS_INLINE T dormand_prince_lanes(
+                T* data, int stride, int i, int lane, T* times, T* steps, T* first, int blockSize,
+                const Parameters& parameters, const T& t1, const T& absTol, const T& relTol, System& system
+            ){
+                using std::min;
+                using std::max;
+                using std::abs;
+                using std::sqrt;
+                typedef lane_io<V> io;
+                typedef std::array<V, Dim> vector;
+                const V p=parameters.template load<V, T>(i);
+                const V t=io::load(times+lane);
+                const V remaining=V(t1)-t;
+                const V h=min(io::load(steps+lane), remaining);
+                //1 on the step that reaches t1, so that the time lands on it exactly
+                const V last=io::less_equal(remaining, h);
+                vector y, stage, k[7];
+                for(int j=0; j<Dim; ++j){
+                    y[j]=io::load(data+j*stride+i);
+                    k[0][j]=io::load(first+j*blockSize+lane);
+                }
+                for(int s=1; s<7; ++s){
+                    for(int j=0; j<Dim; ++j){
+                        V increment=T(DP_A[s][0])*k[0][j];
+                        for(int r=1; r<s; ++r){
+                            increment+=T(DP_A[s][r])*k[r][j];
+                        }
+                        stage[j]=y[j]+h*increment;
+                    }
+                    k[s]=system(stage, t+T(DP_C[s])*h, p);
+                }
+                V norm=V(0);
+                for(int j=0; j<Dim; ++j){
+                    V estimate=T(DP_E[0])*k[0][j];
+                    for(int s=1; s<7; ++s){
+                        estimate+=T(DP_E[s])*k[s][j];
+                    }
+                    estimate*=h;
+                    const V scale=V(absTol)+relTol*max(abs(y[j]), abs(stage[j]));
+                    norm+=(estimate/scale)*(estimate/scale);
+                }
+                norm=sqrt(norm/T(Dim));
+                //selects rather than blends, since a rejected trial step may hold inf or NaN
+                const V accept=io::less_equal(norm, V(1));
+                const V factor=step_factor(norm);
+                const V time=io::select(accept, io::select(last, V(t1), V(t+h)), t);
+                io::store(time, times+lane);
+                io::store(io::select(accept, V(h*factor), V(h*min(V(1), factor))), steps+lane);
+                for(int j=0; j<Dim; ++j){
+                    io::store(io::select(accept, stage[j], y[j]), data+j*stride+i);
+                    io::store(io::select(accept, k[6][j], k[0][j]), first+j*blockSize+lane);
+                }
+                return io::total(V(1)-io::less_equal(V(t1), time));
+            }
+            template<int Dim, typename T, typename Parameters, typename System>
+            void dormand_prince_batch(T* data, int numSystems, const Parameters& parameters, const T& t0, const T& t1, System& system, const T& absTol, const T& relTol, int maxSteps){
+                typedef simd_pack<T> pack;
+                typedef std::array<T, Dim> vector;
+                #pragma omp parallel for
+                for(int begin=0; begin<numSystems; begin+=ODE_BLOCK_SIZE){
+                    const int m=std::min(ODE_BLOCK_SIZE, numSystems-begin);
+                    //time, step and first stage of every system in the block
+                    std::vector<T> times(m, t0);
+                    std::vector<T> steps(m);
+                    std::vector<T> first(Dim*m);
+                    for(int lane=0; lane<m; ++lane){
+                        vector y;
+                        for(int j=0; j<Dim; ++j){
+                            y[j]=data[j*numSystems+begin+lane];
+                        }
+                        const vector dy=system(y, t0, parameters.template load<T, T>(begin+lane));
+                        T yNorm=0;
+                        T dyNorm=0;
+                        for(int j=0; j<Dim; ++j){
+                            first[j*m+lane]=dy[j];
+                            const T scale=absTol+relTol*std::abs(y[j]);
+                            yNorm+=(y[j]/scale)*(y[j]/scale);
+                            dyNorm+=(dy[j]/scale)*(dy[j]/scale);
+                        }
+                        const T h=(yNorm<T(1e-10)||dyNorm<T(1e-10))?T(1e-6):T(0.01)*std::sqrt(yNorm/dyNorm);
+                        steps[lane]=std::min(h, t1-t0);
+                    }
+                    T running=m;
+                    for(int attempt=0; attempt<maxSteps&&running>0; ++attempt){
+                        running=0;
+                        int lane=0;
+                        for(; lane+pack::width<=m; lane+=pack::width){
+                            running+=dormand_prince_lanes<Dim, pack>(data, numSystems, begin+lane, lane, times.data(), steps.data(), first.data(), m, parameters, t1, absTol, relTol, system);
+                        }
+                        for(; lane<m; ++lane){
+                            running+=dormand_prince_lanes<Dim, T>(data, numSystems, begin+lane, lane, times.data(), steps.data(), first.data(), m, parameters, t1, absTol, relTol, system);
+                        }
+                    }
+                }
+            }
+        }
+        /**
+            Fourth order Runge-Kutta on a batch of systems of dimension Dim 
+            with a fixed step.  Like for_each_simd, system is called with 
+            simd_packs holding consecutive systems and with scalars for 
+            the systems that do not fill a pack, so it must work for 
+            both, eg [](const auto& y, const auto& t){return std::decay_t<decltype(y)>{{y[1], -y[0]}};}.  
+            This function runs in parallel when compiled with openmp 
+            enabled
+            @states initial states, component j of system i at j*numSystems+i
+            @t0 initial time
+            @t1 final time
+            @numSteps number of equal steps
+            @system function of (y, t) for a std::array y of packs or scalars, returning the std::array of derivatives
+            @returns states at t1 in the same layout
+        */
+        template<int Dim, typename Array, typename T, typename System>
+        auto rk4_batch(Array&& states, const T& t0, const T& t1, int numSteps, System&& system){
+            auto withParameter=[&](const auto& y, const auto& t, const auto& p){
+                return system(y, t);
+            };
+            detail::rk4_batch<Dim>(states.data(), (int)states.size()/Dim, detail::no_parameters(), t0, t1, numSteps, withParameter);
+            return std::move(states);
+        }
+        /**
+            Fourth order Runge-Kutta on a batch of systems that differ by 
+            a parameter, see rk4_batch.  This function runs in parallel 
+            when compiled with openmp enabled
+            @states initial states, component j of system i at j*numSystems+i
+            @parameters std-style contiguous container with the parameter of every system
+            @t0 initial time
+            @t1 final time
+            @numSteps number of equal steps
+            @system function of (y, t, parameter) with packs or scalars, returning the std::array of derivatives
+            @returns states at t1 in the same layout
+        */
+        template<int Dim, typename Array, typename Parameters, typename T, typename System>
+        auto rk4_batch(Array&& states, const Parameters& parameters, const T& t0, const T& t1, int numSteps, System&& system){
+            detail::rk4_batch<Dim>(states.data(), (int)states.size()/Dim, detail::parameter_array<T>{parameters.data()}, t0, t1, numSteps, system);
+            return std::move(states);
+        }
+        /**
+            Adaptive Dormand-Prince 5(4) on a batch of systems of dimension 
+            Dim, with system called on packs and scalars as in rk4_batch.  
+            Every system keeps its own time and step size, so t is a pack 
+            too; systems that reach t1 first idle with a zero step while 
+            the rest of their block finishes.  This function runs in 
+            parallel when compiled with openmp enabled
+            @states initial states, component j of system i at j*numSystems+i
+            @t0 initial time
+            @t1 final time, greater than t0
+            @system function of (y, t) for a std::array y of packs or scalars, returning the std::array of derivatives
+            @absTol absolute tolerance
+            @relTol relative tolerance
+            @maxSteps maximum number of attempted steps per system
+            @returns states at t1 in the same layout
+        */
+        template<int Dim, typename Array, typename T, typename System>
+        auto dormand_prince_batch(Array&& states, const T& t0, const T& t1, System&& system, const T& absTol=1e-8, const T& relTol=1e-8, int maxSteps=100000){
+            auto withParameter=[&](const auto& y, const auto& t, const auto&){
+                return system(y, t);
+            };
+            detail::dormand_prince_batch<Dim>(states.data(), (int)states.size()/Dim, detail::no_parameters(), t0, t1, withParameter, absTol, relTol, maxSteps);
+            return std::move(states);
+        }
+        /**
+            Adaptive Dormand-Prince 5(4) on a batch of systems that differ 
+            by a parameter, see dormand_prince_batch.  This function runs 
+            in parallel when compiled with openmp enabled
+            @states initial states, component j of system i at j*numSystems+i
+            @parameters std-style contiguous container with the parameter of every system
+            @t0 initial time
+            @t1 final time, greater than t0
+            @system function of (y, t, parameter) with packs or scalars, returning the std::array of derivatives
+            @absTol absolute tolerance
+            @relTol relative tolerance
+            @maxSteps maximum number of attempted steps per system
+            @returns states at t1 in the same layout
+        */
+        template<int Dim, typename Array, typename Parameters, typename T, typename System>
+        auto dormand_prince_batch(Array&& states, const Parameters& parameters, const T& t0, const T& t1, System&& system, const T& absTol=1e-8, const T& relTol=1e-8, int maxSteps=100000){
+            detail::dormand_prince_batch<Dim>(states.data(), (int)states.size()/Dim, detail::parameter_array<T>{parameters.data()}, t0, t1, system, absTol, relTol, maxSteps);
+            return std::move(states);
+        }
+    }
+
+    /**
+        Low discrepancy sequences for quasi Monte Carlo.  Like 
+        random::counter_rng, every value is a pure function of (index, 
+        dimension), so points can be drawn in any order, eg from 
+        for_each_parallel or the parallel sum, without sequential state.  
+        Scrambled sequences stay low discrepancy and make the error 
+        estimable from independent seeds.
+    */
+    namespace quasi_random{
+        namespace detail{
+            constexpr int QUASI_RANDOM_BLOCK_SIZE=4096;
+            constexpr int SOBOL_MAX_DIMENSION=64;
+            constexpr int SOBOL_MAX_DEGREE=9;
+            constexpr int SOBOL_BITS=32;
+            /**primitive polynomials of dimensions 1 onwards, with the leading and constant terms as bits*/
+            constexpr std::uint32_t SOBOL_POLYNOMIALS[SOBOL_MAX_DIMENSION-1]={
+                3, 7, 11, 13, 19, 25, 37, 41, 47, 55, 59, 61,
+                67, 91, 97, 103, 109, 115, 131, 137, 143, 145, 157, 167,
+                171, 185, 191, 193, 203, 211, 213, 229, 239, 241, 247, 253,
+                285, 299, 301, 333, 351, 355, 357, 361, 369, 391, 397, 425,
+                451, 463, 487, 501, 529, 539, 545, 557, 563, 601, 607, 617,
+                623, 631, 637
+            };
+            /**initial direction numbers m_1..m_s of each polynomial, Joe and Kuo (2008)*/
+            constexpr std::uint32_t SOBOL_INITIAL[SOBOL_MAX_DIMENSION-1][SOBOL_MAX_DEGREE]={
+                {1}, {1, 3}, {1, 3, 1}, {1, 1, 1},
+                {1, 1, 3, 3}, {1, 3, 5, 13}, {1, 1, 5, 5, 17}, {1, 1, 5, 5, 5},
+                {1, 1, 7, 11, 19}, {1, 1, 5, 1, 1}, {1, 1, 1, 3, 11}, {1, 3, 5, 5, 31},
+                {1, 3, 3, 9, 7, 49}, {1, 1, 1, 15, 21, 21}, {1, 3, 1, 13, 27, 49}, {1, 1, 1, 15, 7, 5},
+                {1, 3, 1, 15, 13, 25}, {1, 1, 5, 5, 19, 61}, {1, 3, 7, 11, 23, 15, 103}, {1, 3, 7, 13, 13, 15, 69},
+                {1, 1, 3, 13, 7, 35, 63}, {1, 3, 5, 9, 1, 25, 53}, {1, 3, 1, 13, 9, 35, 107}, {1, 3, 1, 5, 27, 61, 31},
+                {1, 1, 5, 11, 19, 41, 61}, {1, 3, 5, 3, 3, 13, 69}, {1, 1, 7, 13, 1, 19, 1}, {1, 3, 7, 5, 13, 19, 59},
+                {1, 1, 3, 9, 25, 29, 41}, {1, 3, 5, 13, 23, 1, 55}, {1, 3, 7, 3, 13, 59, 17}, {1, 3, 1, 3, 5, 53, 69},
+                {1, 1, 5, 5, 23, 33, 13}, {1, 1, 7, 7, 1, 61, 123}, {1, 1, 7, 9, 13, 61, 49}, {1, 3, 3, 5, 3, 55, 33},
+                {1, 3, 1, 15, 31, 13, 49, 245}, {1, 3, 5, 15, 31, 59, 63, 97}, {1, 3, 1, 11, 11, 11, 77, 249}, {1, 3, 1, 11, 27, 43, 71, 9},
+                {1, 1, 7, 15, 21, 11, 81, 45}, {1, 3, 7, 3, 25, 31, 65, 79}, {1, 3, 1, 1, 19, 11, 3, 205}, {1, 1, 5, 9, 19, 21, 29, 157},
+                {1, 3, 7, 11, 1, 33, 89, 185}, {1, 3, 3, 3, 15, 9, 79, 71}, {1, 3, 7, 11, 15, 39, 119, 27}, {1, 1, 3, 1, 11, 31, 97, 225},
+                {1, 1, 1, 3, 23, 43, 57, 177}, {1, 3, 7, 7, 17, 17, 37, 71}, {1, 3, 1, 5, 27, 63, 123, 213}, {1, 1, 3, 5, 11, 43, 53, 133},
+                {1, 3, 5, 5, 29, 17, 47, 173, 479}, {1, 3, 3, 11, 3, 1, 109, 9, 69}, {1, 1, 1, 5, 17, 39, 23, 5, 343}, {1, 3, 1, 5, 25, 15, 31, 103, 499},
+                {1, 1, 1, 11, 11, 17, 63, 105, 183}, {1, 1, 5, 11, 9, 29, 97, 231, 363}, {1, 1, 5, 15, 19, 45, 41, 7, 383}, {1, 3, 7, 7, 31, 19, 83, 137, 221},
+                {1, 1, 1, 3, 23, 15, 111, 223, 83}, {1, 1, 5, 13, 31, 15, 55, 25, 161}, {1, 1, 3, 13, 25, 47, 39, 87, 257}
+            };
+            constexpr int HALTON_MAX_DIMENSION=64;
+            constexpr std::uint32_t HALTON_PRIMES[HALTON_MAX_DIMENSION]={
+                2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+                59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+                137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+                227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311
+            };
+            /**finalizer of murmur3, which spreads every input bit over the output*/
+            FUTILITIES_ALWAYS_INLINE std::uint64_t mix_bits(std::uint64_t x){
+                x^=x>>33;
+                x*=0xff51afd7ed558ccdull;
+                x^=x>>33;
+                x*=0xc4ceb9fe1a85ec53ull;
+                x^=x>>33;
+                return x;
+            }
+            FUTILITIES_ALWAYS_INLINE std::uint32_t reverse_bits(std::uint32_t x){
+                x=((x>>1)&0x55555555u)|((x&0x55555555u)<<1);
+                x=((x>>2)&0x33333333u)|((x&0x33333333u)<<2);
+                x=((x>>4)&0x0f0f0f0fu)|((x&0x0f0f0f0fu)<<4);
+                x=((x>>8)&0x00ff00ffu)|((x&0x00ff00ffu)<<8);
+                return (x>>16)|(x<<16);
+            }
+            /**
+                Owen scrambling of a base 2 fraction held in 32 bits: the 
+                hash of Laine and Karras, improved by Burley (2020), on 
+                the reversed bits flips every bit depending only on the 
+                bits above it
+            */
+            FUTILITIES_ALWAYS_INLINE std::uint32_t owen_scramble(std::uint32_t x, std::uint32_t seed){
+                x=reverse_bits(x);
+                x+=seed;
+                x^=x*0x6c50b47cu;
+                x^=x*0xb82f1e52u;
+                x^=x*0xc7afe638u;
+                x^=x*0x8d22f6e6u;
+                return reverse_bits(x);
+            }
+            FUTILITIES_ALWAYS_INLINE int trailing_zeros(std::uint64_t x){
+                #ifdef __GNUC__
+                    return __builtin_ctzll(x);
+                #else
+                    int result=0;
+                    for(; (x&1)==0; x>>=1){
+                        ++result;
+                    }
+                    return result;
+                #endif
+            }
+            /**the number of dimensions, which the tables of the sequences bound*/
+            inline int checked_dimensions(int dimensions, int maximum){
+                if(dimensions<0||dimensions>maximum){
+                    throw std::out_of_range("quasi_random: more dimensions than the sequence tabulates");
+                }
+                return dimensions;
+            }
+            /**32 bit fraction to a float or double in [0, 1)*/
+            template<typename T>
+            struct fraction;
+            template<>
+            struct fraction<double>{
+                FUTILITIES_ALWAYS_INLINE static double convert(std::uint32_t x){
+                    return x*2.3283064365386962890625e-10;
+                }
+            };
+            template<>
+            struct fraction<float>{
+                FUTILITIES_ALWAYS_INLINE static float convert(std::uint32_t x){
+                    return (x>>8)*5.9604644775390625e-8f;
+                }
+            };
+        }
+        /**
+            Sobol sequence in up to 64 dimensions with the direction 
+            numbers of Joe and Kuo (2008), in Gray code order so that the 
+            points match the usual implementations.  Every power of two 
+            number of points starting from index 0 is stratified in each 
+            dimension.  Indices are below 2^32, as the direction numbers 
+            have 32 bits.
+        */
+        class sobol{
+        public:
+            /**
+                Unscrambled sequence, whose first point is the origin.  
+                Throws std::out_of_range for more than 64 dimensions
+                @dimensions number of dimensions, at most 64
+            */
+            explicit sobol(int dimensions):
+                directions(detail::checked_dimensions(dimensions, detail::SOBOL_MAX_DIMENSION)*detail::SOBOL_BITS),
+                seeds(dimensions, 0),
+                scrambled(false)
+            {
+                for(int d=0; d<dimensions; ++d){
+                    std::uint32_t* v=directions.data()+d*detail::SOBOL_BITS;
+                    if(d==0){
+                        for(int k=0; k<detail::SOBOL_BITS; ++k){
+                            v[k]=1u<<(detail::SOBOL_BITS-1-k);
+                        }
+                        continue;
+                    }
+                    const std::uint32_t polynomial=detail::SOBOL_POLYNOMIALS[d-1];
+                    int degree=0;
+                    while(polynomial>>(degree+1)){
+                        ++degree;
+                    }
+                    for(int k=0; k<degree; ++k){
+                        v[k]=detail::SOBOL_INITIAL[d-1][k]<<(detail::SOBOL_BITS-1-k);
+                    }
+                    //recurrence of Bratley and Fox over the coefficients of the polynomial
+                    for(int k=degree; k<detail::SOBOL_BITS; ++k){
+                        v[k]=v[k-degree]^(v[k-degree]>>degree);
+                        for(int i=1; i<degree; ++i){
+                            v[k]^=((polynomial>>(degree-i))&1)*v[k-i];
+                        }
+                    }
+                }
+            }
+            /**
+                Owen scrambled sequence.  Throws std::out_of_range for more 
+                than 64 dimensions
+                @dimensions number of dimensions, at most 64
+                @seed seed of the scrambling
+            */
+            sobol(int dimensions, std::uint64_t seed):sobol(dimensions){
+                scrambled=true;
+                for(int d=0; d<dimensions; ++d){
+                    seeds[d]=(std::uint32_t)detail::mix_bits(seed^detail::mix_bits(d+1));
+                }
+            }
+            int dimensions() const{
+                return seeds.size();
+            }
+            /**
+                @index position in the sequence, below 2^32
+                @dimension coordinate of the point, below dimensions()
+                @returns coordinate in [0, 1)
+            */
+            template<typename T=double>
+            T uniform(std::uint64_t index, int dimension) const{
+                assert(index>>detail::SOBOL_BITS==0&&dimension>=0&&dimension<dimensions());
+                const std::uint32_t* v=directions.data()+dimension*detail::SOBOL_BITS;
+                std::uint32_t gray=(std::uint32_t)(index^(index>>1));
+                std::uint32_t x=0;
+                for(int k=0; gray; ++k, gray>>=1){
+                    x^=v[k]&(0u-(gray&1u));
+                }
+                return convert<T>(x, dimension);
+            }
+            /**
+                Sets array[k]=uniform(firstIndex+k, dimension), updating 
+                the previous value with one direction number per point.  
+                This function runs in parallel when compiled with openmp 
+                enabled
+                @array std-style contiguous container of float or double
+                @dimension coordinate of the points, below dimensions()
+                @firstIndex index of array[0], with the last index below 2^32
+                @returns filled array
+            */
+            template<typename Array>
+            auto fill_dimension(Array&& array, int dimension, std::uint64_t firstIndex=0) const{
+                typedef std::decay_t<decltype(array[0])> T;
+                const int n=array.size();
+                T* data=array.data();
+                assert((firstIndex+n-(n>0))>>detail::SOBOL_BITS==0&&dimension>=0&&dimension<dimensions());
+                const std::uint32_t* v=directions.data()+dimension*detail::SOBOL_BITS;
+                #pragma omp parallel for if(n>detail::QUASI_RANDOM_BLOCK_SIZE)
+                for(int begin=0; begin<n; begin+=detail::QUASI_RANDOM_BLOCK_SIZE){
+                    const int end=std::min(begin+detail::QUASI_RANDOM_BLOCK_SIZE, n);
+                    std::uint64_t index=firstIndex+begin;
+                    std::uint32_t gray=(std::uint32_t)(index^(index>>1));
+                    std::uint32_t x=0;
+                    for(int k=0; gray; ++k, gray>>=1){
+                        x^=v[k]&(0u-(gray&1u));
+                    }
+                    data[begin]=convert<T>(x, dimension);
+                    for(int i=begin+1; i<end; ++i, ++index){
+                        //the Gray codes of index and index+1 differ in the lowest zero bit of index
+                        x^=v[detail::trailing_zeros(~index)];
+                        data[i]=convert<T>(x, dimension);
+                    }
+                }
+                return std::move(array);
+            }
+        private:
+            std::vector<std::uint32_t> directions;
+            std::vector<std::uint32_t> seeds;
+            bool scrambled;
+
+            template<typename T>
+            FUTILITIES_ALWAYS_INLINE T convert(std::uint32_t x, int dimension) const{
+                return detail::fraction<T>::convert(scrambled?detail::owen_scramble(x, seeds[dimension]):x);
+            }
+        };
+        /**
+            Halton sequence in up to 64 dimensions: dimension d is the 
+            radical inverse of the index in the d-th prime.  Scrambling 
+            adds to every digit a random shift that depends on the digits 
+            before it, a nested form of Owen scrambling that keeps the 
+            points of every b^k block stratified.
+        */
+        class halton{
+        public:
+            /**
+                Unscrambled sequence, whose first point is the origin.  
+                Throws std::out_of_range for more than 64 dimensions
+                @dimensions number of dimensions, at most 64
+            */
+            explicit halton(int dimensions):seeds(detail::checked_dimensions(dimensions, detail::HALTON_MAX_DIMENSION), 0), scrambled(false){}
+            /**
+                Scrambled sequence.  Throws std::out_of_range for more than 
+                64 dimensions
+                @dimensions number of dimensions, at most 64
+                @seed seed of the scrambling
+            */
+            halton(int dimensions, std::uint64_t seed):seeds(detail::checked_dimensions(dimensions, detail::HALTON_MAX_DIMENSION)), scrambled(true){
+                for(int d=0; d<dimensions; ++d){
+                    seeds[d]=detail::mix_bits(seed^detail::mix_bits(d+1));
+                }
+            }
+            int dimensions() const{
+                return seeds.size();
+            }
+            /**
+                @index position in the sequence
+                @dimension coordinate of the point, below dimensions()
+                @returns coordinate in [0, 1)
+            */
+            template<typename T=double>
+            T uniform(std::uint64_t index, int dimension) const{
+                assert(dimension>=0&&dimension<dimensions());
+                const std::uint32_t base=detail::HALTON_PRIMES[dimension];
+                const double inverseBase=1.0/base;
+                double factor=inverseBase;
+                double result=0.0;
+                if(!scrambled){
+                    for(; index>0; index/=base, factor*=inverseBase){
+                        result+=(index%base)*factor;
+                    }
+                }
+                else{
+                    //shifts continue past the last digit of the index, until they fall below the precision
+                    std::uint64_t prefix=seeds[dimension];
+                    for(; factor>1e-17; index/=base, factor*=inverseBase){
+                        const std::uint64_t shift=detail::mix_bits(prefix)%base;
+                        const std::uint64_t digit=(index%base+shift)%base;
+                        result+=digit*factor;
+                        prefix=prefix*0x9e3779b97f4a7c15ull+index%base+1;
+                    }
+                }
+                return std::min((T)result, T(1)-std::numeric_limits<T>::epsilon()/T(2));
+            }
+            /**
+                Sets array[k]=uniform(firstIndex+k, dimension).  This 
+                function runs in parallel when compiled with openmp enabled
+                @array std-style contiguous container of float or double
+                @dimension coordinate of the points, below dimensions()
+                @firstIndex index of array[0]
+                @returns filled array
+            */
+            template<typename Array>
+            auto fill_dimension(Array&& array, int dimension, std::uint64_t firstIndex=0) const{
+                typedef std::decay_t<decltype(array[0])> T;
+                const int n=array.size();
+                T* data=array.data();
+                #pragma omp parallel for if(n>detail::QUASI_RANDOM_BLOCK_SIZE)
+                for(int i=0; i<n; ++i){
+                    data[i]=uniform<T>(firstIndex+i, dimension);
+                }
+                return std::move(array);
+            }
+        private:
+            std::vector<std::uint64_t> seeds;
+            bool scrambled;
+        };
+    }
+
+    /**
+        Static search indices over a sorted array, such as the output of 
+        cumulative_sum or for_emplace_back, answering lower_bound and 
+        upper_bound like the std:: versions but with a memory layout 
+        that suits the cache.  Searches descend a fixed number of levels 
+        without branches, and the batched versions interleave groups of 
+        queries so that their cache misses overlap.
+    */
+    namespace search{
+        namespace detail{
+            /**queries per block in the parallel batched searches*/
+            constexpr int SEARCH_BLOCK_SIZE=4096;
+            /**searches interleaved so that their cache misses overlap*/
+            constexpr int SEARCH_GROUP_SIZE=16;
+            /**levels ahead that searches of the Eytzinger layout prefetch*/
+            constexpr int EYTZINGER_PREFETCH_LEVELS=4;
+            /**keys per S+ tree node by default fill one cache line*/
+            constexpr int CACHE_LINE_BYTES=64;
+
+            FUTILITIES_ALWAYS_INLINE void prefetch(const void* address){
+                #ifdef __GNUC__
+                    __builtin_prefetch(address);
+                #endif
+            }
+            FUTILITIES_ALWAYS_INLINE int trailing_ones(unsigned int x){
+                #ifdef __GNUC__
+                    return __builtin_ctz(~x);
+                #else
+                    int result=0;
+                    for(; x&1; x>>=1){
+                        ++result;
+                    }
+                    return result;
+                #endif
+            }
+            /**whether a search for x continues past key: key<x for lower_bound and key<=x for upper_bound*/
+            template<bool Upper>
+            struct goes_past;
+            template<>
+            struct goes_past<false>{
+                template<typename T>
+                FUTILITIES_ALWAYS_INLINE static bool apply(const T& key, const T& x){
+                    return key<x;
+                }
+            };
+            template<>
+            struct goes_past<true>{
+                template<typename T>
+                FUTILITIES_ALWAYS_INLINE static bool apply(const T& key, const T& x){
+                    return key<=x;
+                }
+            };
+            /**
+                Runs groupSearch(keys, result, count) on SEARCH_GROUP_SIZE 
+                queries at a time in parallel blocks, with every key the 
+                query times scale
+            */
+            template<typename T, typename Array, typename GroupSearch>
+            std::vector<int> search_batch(const Array& queries, const T& scale, GroupSearch&& groupSearch){
+                constexpr int group=SEARCH_GROUP_SIZE;
+                const int m=queries.size();
+                const auto* x=queries.data();
+                std::vector<int> result(m);
+                int* out=result.data();
+                #pragma omp parallel for if(m>SEARCH_BLOCK_SIZE)
+                for(int begin=0; begin<m; begin+=SEARCH_BLOCK_SIZE){
+                    const int end=std::min(begin+SEARCH_BLOCK_SIZE, m);
+                    T keys[group];
+                    for(int j=begin; j<end; j+=group){
+                        const int count=std::min(group, end-j);
+                        for(int l=0; l<count; ++l){
+                            keys[l]=x[j+l]*scale;
+                        }
+                        groupSearch(keys, out+j, count);
+                    }
+                }
+                return result;
+            }
+        }
+        /**
+            Sorted values in Eytzinger (breadth first) order: the implicit 
+            binary search tree with the children of position k at 2k and 
+            2k+1.  The first levels of every search share a few cache 
+            lines, and every search prefetches the node four levels below 
+            it, whose 16 descendants are contiguous.  Takes 1.5 times the 
+            memory of the array for double.
+        */
+        template<typename T=double>
+        class eytzinger{
+        public:
+            /**
+                @sorted std-style container sorted in ascending order
+            */
+            template<typename Array>
+            explicit eytzinger(const Array& sorted):
+                n(sorted.size()),
+                levels(0),
+                layout(sorted.size()+1),
+                rank(sorted.size()+1)
+            {
+                while((1ll<<levels)<=n){
+                    ++levels;
+                }
+                //in order traversal: descend left past the leaves, climb back to the next node, visit, step right
+                auto it=sorted.begin();
+                unsigned int k=1;
+                for(int i=0; i<n; ++i, ++it){
+                    while(k<=(unsigned int)n){
+                        k*=2;
+                    }
+                    k>>=detail::trailing_ones(k)+1;
+                    layout[k]=*it;
+                    rank[k]=i;
+                    k=2*k+1;
+                }
+                //searches that never go left end at the root's rank
+                rank[0]=n;
+            }
+            int size() const{
+                return n;
+            }
+            /**
+                @x value to search for
+                @returns index of the first value not less than x, or size()
+            */
+            int lower_bound(const T& x) const{
+                return bound<false>(x);
+            }
+            /**
+                @x value to search for
+                @returns index of the first value greater than x, or size()
+            */
+            int upper_bound(const T& x) const{
+                return bound<true>(x);
+            }
+            /**
+                lower_bound of every query.  This function runs in parallel 
+                when compiled with openmp enabled
+                @queries std-style contiguous container of values
+                @returns indices
+            */
+            template<typename Array>
+            std::vector<int> lower_bound_batch(const Array& queries) const{
+                return detail::search_batch<T>(queries, T(1), [&](const T* x, int* result, int count){
+                    bound_group<false>(x, result, count);
+                });
+            }
+            /**
+                upper_bound of every query.  This function runs in parallel 
+                when compiled with openmp enabled
+                @queries std-style contiguous container of values
+                @returns indices
+            */
+            template<typename Array>
+            std::vector<int> upper_bound_batch(const Array& queries) const{
+                return detail::search_batch<T>(queries, T(1), [&](const T* x, int* result, int count){
+                    upper_bound_group(x, result, count);
+                });
+            }
+            /**
+                upper_bound of up to detail::SEARCH_GROUP_SIZE values, with 
+                the searches interleaved level by level
+                @x values to search for
+                @result indices of the first values greater than x, or size()
+                @count number of values
+            */
+            void upper_bound_group(const T* x, int* result, int count) const{
+                bound_group<true>(x, result, count);
+            }
+        private:
+            int n;
+            int levels;
+            std::vector<T> layout;
+            std::vector<int> rank;
+
+            /**the node reached at the leaves, with the rank of the last node where the search went left*/
+            FUTILITIES_ALWAYS_INLINE int rank_of(unsigned int k) const{
+                return rank[k>>(detail::trailing_ones(k)+1)];
+            }
+            template<bool Upper>
+            FUTILITIES_ALWAYS_INLINE unsigned int step(unsigned int k, const T& x) const{
+                detail::prefetch(layout.data()+(k<<detail::EYTZINGER_PREFETCH_LEVELS));
+                //off the tree always goes right, whatever the keys, eg -inf
+                const bool outside=k>(unsigned int)n;
+                return 2*k+(outside|detail::goes_past<Upper>::apply(layout[outside?0:k], x));
+            }
+            template<bool Upper>
+            int bound(const T& x) const{
+                unsigned int k=1;
+                for(int level=0; level<levels; ++level){
+                    k=step<Upper>(k, x);
+                }
+                return rank_of(k);
+            }
+            template<bool Upper>
+            void bound_group(const T* x, int* result, int count) const{
+                unsigned int k[detail::SEARCH_GROUP_SIZE];
+                for(int j=0; j<count; ++j){
+                    k[j]=1;
+                }
+                for(int level=0; level<levels; ++level){
+                    for(int j=0; j<count; ++j){
+                        k[j]=step<Upper>(k[j], x[j]);
+                    }
+                }
+                for(int j=0; j<count; ++j){
+                    result[j]=rank_of(k[j]);
+                }
+            }
+        };
+        /**
+            Static B+ tree (S+ tree) with B keys per node, one cache line 
+            by default, and B+1 children.  The bottom layer is the sorted 
+            array itself, padded to whole nodes, and every key of the 
+            layers above is the smallest value of the subtree to its 
+            right.  Each level is one count of the keys of a node below x, 
+            which vectorizes, so a search touches log_(B+1)(n) nodes 
+            instead of log_2(n) cache lines.  Takes about (B+2)/(B+1) 
+            times the memory of the array.
+        */
+        template<typename T=double, int B=detail::CACHE_LINE_BYTES/(int)sizeof(T)>
+        class s_tree{
+        public:
+            /**
+                @sorted std-style container sorted in ascending order
+            */
+            template<typename Array>
+            explicit s_tree(const Array& sorted):n(sorted.size()){
+                const T pad=std::numeric_limits<T>::has_infinity?std::numeric_limits<T>::infinity():std::numeric_limits<T>::max();
+                //nodes per layer, from the sorted array upwards
+                nodes.push_back(std::max(1, (n+B-1)/B));
+                while(nodes.back()>1){
+                    nodes.push_back((nodes.back()+B)/(B+1));
+                }
+                offsets.push_back(0);
+                for(int h=1; h<(int)nodes.size(); ++h){
+                    offsets.push_back(offsets[h-1]+nodes[h-1]*B);
+                }
+                keys.assign(offsets.back()+nodes.back()*B, pad);
+                std::copy(sorted.begin(), sorted.end(), keys.begin());
+                const int leaves=nodes[0];
+                for(int h=1; h<(int)nodes.size(); ++h){
+                    T* layer=keys.data()+offsets[h];
+                    const int numKeys=nodes[h]*B;
+                    #pragma omp parallel for
+                    for(int key=0; key<numKeys; ++key){
+                        //leftmost leaf of the child to the right of the key
+                        int k=(key/B)*(B+1)+key%B+1;
+                        for(int l=h-1; l>0; --l){
+                            k*=B+1;
+                        }
+                        layer[key]=k<leaves?keys[k*B]:pad;
+                    }
+                }
+            }
+            int size() const{
+                return n;
+            }
+            /**
+                @x value to search for
+                @returns index of the first value not less than x, or size()
+            */
+            int lower_bound(const T& x) const{
+                return bound<false>(x);
+            }
+            /**
+                @x value to search for
+                @returns index of the first value greater than x, or size()
+            */
+            int upper_bound(const T& x) const{
+                return bound<true>(x);
+            }
+            /**
+                lower_bound of every query.  This function runs in parallel 
+                when compiled with openmp enabled
+                @queries std-style contiguous container of values
+                @returns indices
+            */
+            template<typename Array>
+            std::vector<int> lower_bound_batch(const Array& queries) const{
+                return detail::search_batch<T>(queries, T(1), [&](const T* x, int* result, int count){
+                    bound_group<false>(x, result, count);
+                });
+            }
+            /**
+                upper_bound of every query.  This function runs in parallel 
+                when compiled with openmp enabled
+                @queries std-style contiguous container of values
+                @returns indices
+            */
+            template<typename Array>
+            std::vector<int> upper_bound_batch(const Array& queries) const{
+                return detail::search_batch<T>(queries, T(1), [&](const T* x, int* result, int count){
+                    bound_group<true>(x, result, count);
+                });
+            }
+        private:
+            int n;
+            std::vector<int> nodes;
+            std::vector<int> offsets;
+            std::vector<T> keys;
+
+            /**number of keys of the node that the search for x goes past*/
+            template<bool Upper>
+            FUTILITIES_ALWAYS_INLINE int count(const T* node, const T& x) const{
+                int result=0;
+                FUTILITIES_OMP_SIMD_REDUCTION(+:result)
+                for(int j=0; j<B; ++j){
+                    result+=detail::goes_past<Upper>::apply(node[j], x);
+                }
+                return result;
+            }
+            /**child of node k of layer h; past the last node only when x is beyond every value*/
+            template<bool Upper>
+            FUTILITIES_ALWAYS_INLINE int step(int k, int h, const T& x) const{
+                return std::min(k*(B+1)+count<Upper>(keys.data()+offsets[h]+k*B, x), nodes[h-1]-1);
+            }
+            template<bool Upper>
+            int bound(const T& x) const{
+                int k=0;
+                for(int h=nodes.size()-1; h>0; --h){
+                    k=step<Upper>(k, h, x);
+                }
+                return std::min(n, k*B+count<Upper>(keys.data()+k*B, x));
+            }
+            template<bool Upper>
+            void bound_group(const T* x, int* result, int count) const{
+                int k[detail::SEARCH_GROUP_SIZE];
+                for(int j=0; j<count; ++j){
+                    k[j]=0;
+                }
+                for(int h=nodes.size()-1; h>0; --h){
+                    for(int j=0; j<count; ++j){
+                        k[j]=step<Upper>(k[j], h, x[j]);
+                        detail::prefetch(keys.data()+offsets[h-1]+k[j]*B);
+                    }
+                }
+                for(int j=0; j<count; ++j){
+                    result[j]=std::min(n, k[j]*B+this->template count<Upper>(keys.data()+k[j]*B, x[j]));
+                }
+            }
+        };
+    }
+
+    /**
+        Sampling from discrete distributions given by weights, with the 
+        uniforms supplied by the caller, eg from random::counter_rng or 
+        quasi_random::sobol.  alias_table draws in constant time with one 
+        random memory access; cdf_table inverts the cumulative sum and 
+        keeps the order of the outcomes, which suits quasi random 
+        uniforms.
+    */
+    namespace discrete{
+        namespace detail{
+            /**samples per block in the parallel batched sampling*/
+            constexpr int DISCRETE_BLOCK_SIZE=4096;
+        }
+        /**
+            Alias table of Walker and Vose: outcome i is kept with 
+            probability threshold[i] and otherwise replaced by alias[i], so 
+            a draw is one multiplication, one comparison and one memory 
+            access.  The table is built in O(n) by the sweeping pairing of 
+            Huebschle-Schneider and Sanders, which needs no work lists, 
+            after a parallel normalization.
+        */
+        template<typename T=double>
+        class alias_table{
+        public:
+            /**
+                @weights std-style contiguous container of non negative weights, not all zero
+            */
+            template<typename Array>
+            explicit alias_table(const Array& weights):table(weights.size()){
+                const int n=weights.size();
+                const auto* w=weights.data();
+                const T total=futilities::detail::parallel_sum(n, [&](int i){
+                    return (T)w[i];
+                });
+                const T scale=n/total;
+                entry* data=table.data();
+                #pragma omp parallel for
+                for(int i=0; i<n; ++i){
+                    data[i].threshold=w[i]*scale;
+                    data[i].alias=i;
+                }
+                //lights take the rest of their slot from the current heavy, which becomes light in turn once 
+                //its surplus is used up.  Slots already paired have an alias other than themselves
+                auto nextLight=[&](int i){
+                    while(i<n&&(data[i].threshold>=T(1)||data[i].alias!=i)){
+                        ++i;
+                    }
+                    return i;
+                };
+                auto nextHeavy=[&](int i){
+                    while(i<n&&data[i].threshold<T(1)){
+                        ++i;
+                    }
+                    return i;
+                };
+                int light=nextLight(0);
+                int heavy=nextHeavy(0);
+                T residual=heavy<n?data[heavy].threshold:T(0);
+                while(heavy<n){
+                    if(residual<T(1)){
+                        const int next=nextHeavy(heavy+1);
+                        if(next>=n){
+                            break;
+                        }
+                        data[heavy].threshold=residual;
+                        data[heavy].alias=next;
+                        residual=data[next].threshold-(T(1)-residual);
+                        heavy=next;
+                    }
+                    else if(light<n){
+                        data[light].alias=heavy;
+                        residual-=T(1)-data[light].threshold;
+                        light=nextLight(light+1);
+                    }
+                    else{
+                        break;
+                    }
+                }
+                //what rounding leaves over keeps its own slot
+                if(heavy<n){
+                    data[heavy].threshold=T(1);
+                }
+                for(; light<n; light=nextLight(light+1)){
+                    if(data[light].alias==light){
+                        data[light].threshold=T(1);
+                    }
+                }
+            }
+            int size() const{
+                return table.size();
+            }
+            /**
+                @u uniform in [0, 1)
+                @returns outcome
+            */
+            FUTILITIES_ALWAYS_INLINE int sample(const T& u) const{
+                const int n=table.size();
+                const T x=u*(T)n;
+                const int i=std::min((int)x, n-1);
+                const entry& e=table[i];
+                return x-(T)i<e.threshold?i:e.alias;
+            }
+            /**
+                Samples for every uniform.  This function runs in parallel 
+                when compiled with openmp enabled
+                @uniforms std-style contiguous container of uniforms in [0, 1)
+                @returns outcomes
+            */
+            template<typename Array>
+            std::vector<int> sample(const Array& uniforms) const{
+                const int m=uniforms.size();
+                const auto* u=uniforms.data();
+                std::vector<int> result(m);
+                int* out=result.data();
+                #pragma omp parallel for if(m>detail::DISCRETE_BLOCK_SIZE)
+                for(int begin=0; begin<m; begin+=detail::DISCRETE_BLOCK_SIZE){
+                    const int end=std::min(begin+detail::DISCRETE_BLOCK_SIZE, m);
+                    FUTILITIES_OMP_SIMD
+                    for(int j=begin; j<end; ++j){
+                        out[j]=sample(T(u[j]));
+                    }
+                }
+                return result;
+            }
+        private:
+            /**threshold and alias side by side so a draw touches one cache line*/
+            struct entry{
+                T threshold;
+                int alias;
+            };
+            std::vector<entry> table;
+        };
+        /**
+            Inversion of the cumulative sum of the weights: outcome i is 
+            drawn for u*total in [cdf[i-1], cdf[i]), as with 
+            std::upper_bound on cumulative_sum_copy of the weights.  The 
+            cumulative sum is held in a search::eytzinger index, so every 
+            search runs without branches and batches interleave their 
+            searches so that cache misses overlap.
+        */
+        template<typename T=double>
+        class cdf_table{
+        public:
+            /**
+                @weights std-style contiguous container of non negative weights, not all zero
+            */
+            template<typename Array>
+            explicit cdf_table(const Array& weights):cdf_table(from_cdf(), cumulate(weights)){}
+            int size() const{
+                return index.size();
+            }
+            /**
+                @u uniform in [0, 1)
+                @returns outcome
+            */
+            int sample(const T& u) const{
+                return std::min(index.size()-1, index.upper_bound(u*total));
+            }
+            /**
+                Samples for every uniform.  This function runs in parallel 
+                when compiled with openmp enabled
+                @uniforms std-style contiguous container of uniforms in [0, 1)
+                @returns outcomes
+            */
+            template<typename Array>
+            std::vector<int> sample(const Array& uniforms) const{
+                const int last=index.size()-1;
+                return search::detail::search_batch<T>(uniforms, total, [&](const T* x, int* result, int count){
+                    index.upper_bound_group(x, result, count);
+                    for(int l=0; l<count; ++l){
+                        result[l]=std::min(last, result[l]);
+                    }
+                });
+            }
+        private:
+            T total;
+            search::eytzinger<T> index;
+
+            struct from_cdf{};
+            cdf_table(from_cdf, const std::vector<T>& cdf):total(cdf.back()), index(cdf){}
+            template<typename Array>
+            static std::vector<T> cumulate(const Array& weights){
+                std::vector<T> cdf(weights.begin(), weights.end());
+                kernels::inclusive_scan(cdf.data(), cdf.data(), cdf.size());
+                return cdf;
+            }
+        };
+    }
+
     template<typename incr, typename init, typename fnToApply>
     auto recurse(const incr& n, const init& initValue, fnToApply&& fn)->decltype(fn(initValue, 0)){
 
@@ -475,4 +6347,14 @@ namespace futilities{
     }*/
     
 }
+/*the helper macros are only for this header*/
+#undef FUTILITIES_ALWAYS_INLINE
+#undef FUTILITIES_PRAGMA
+#undef FUTILITIES_OMP_SIMD
+#undef FUTILITIES_OMP_SIMD_REDUCTION
+#undef FUTILITIES_OMP_PARALLEL_FOR_SIMD
+#undef FUTILITIES_ISA_DISPATCH
+#undef FUTILITIES_ISA_VARIANT
+#undef FUTILITIES_ISA_VARIANTS
+#undef FUTILITIES_ISA_CALL
 #endif
@@ -1,13 +1,70 @@
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 #include "catch.hpp"
 #include "FunctionalUtilities.h"
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <limits>
+#include <random>
+#include <thread>
+#if defined(FUTILITIES_ALWAYS_INLINE)||defined(FUTILITIES_PRAGMA)||defined(FUTILITIES_OMP_SIMD)||defined(FUTILITIES_ISA_CALL)
+    #error "FunctionalUtilities.h leaks its helper macros"
+#endif
  
 TEST_CASE("Test template_power", "[Functional]"){
     double x=2.0;
 
     REQUIRE(futilities::const_power(x, 3)==8.0);
 }
+TEST_CASE("Test template_power zero and negative", "[Functional]"){
+    double x=2.0;
+    REQUIRE(futilities::const_power(x, 0)==1.0);
+    REQUIRE(futilities::const_power(x, -2)==.25);
+    REQUIRE(futilities::int_power(x, 10)==1024.0);
+    REQUIRE(futilities::int_power(3, 5)==243);
+}
+TEST_CASE("Test compile time const_power", "[Functional]"){
+    static_assert(futilities::const_power<0>(3)==1, "zero power");
+    static_assert(futilities::const_power<7>(3)==2187, "odd power");
+    static_assert(futilities::const_power<16>(2)==65536, "even power");
+    static_assert(futilities::int_power(3, 7)==2187, "run time exponent in a constant expression");
+    static_assert(futilities::int_power(2.0, -2)==.25, "negative run time exponent");
+    double x=1.5;
+    REQUIRE(futilities::const_power<13>(x)==Approx(pow(x, 13)));
+    REQUIRE(futilities::const_power<-3>(x)==Approx(pow(x, -3)));
+}
+TEST_CASE("Test for_each_power", "[Functional]"){
+    std::vector<double> testV={1, 2, 3};
+    REQUIRE(futilities::for_each_power<3>(std::move(testV))==std::vector<double>({1, 8, 27}));
+    std::vector<double> testV2={1, 2, 4};
+    REQUIRE(futilities::for_each_power(std::move(testV2), -1)==std::vector<double>({1, .5, .25}));
+}
+TEST_CASE("Test const_power time", "[Functional]"){
+    int n=10000000;
+    std::vector<double> testV=futilities::for_each(0, n, [&](const auto& index){
+        return 1.0+(double)index/n;
+    });
+    std::vector<double> testVNew=testV;
+    std::vector<double> testVStd=testV;
+    auto started = std::chrono::high_resolution_clock::now();
+    testV=futilities::for_each_power<11>(std::move(testV));
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities compile time power: "<<std::chrono::duration_cast<std::chrono::milliseconds>(done-started).count()<<std::endl;
+
+    started = std::chrono::high_resolution_clock::now();
+    testVNew=futilities::for_each_power(std::move(testVNew), 11);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities run time power: "<<std::chrono::duration_cast<std::chrono::milliseconds>(done-started).count()<<std::endl;
+
+    started = std::chrono::high_resolution_clock::now();
+    for(int i=0; i<n;++i){
+        testVStd[i]=std::pow(testVStd[i], 11.0);
+    }
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed std::pow: "<<std::chrono::duration_cast<std::chrono::milliseconds>(done-started).count()<<std::endl;
+    REQUIRE(testV[n-1]==Approx(testVStd[n-1]));
+    REQUIRE(testVNew[n-1]==Approx(testVStd[n-1]));
+}
 
 TEST_CASE("Test for_each_parallel", "[Functional]"){
     std::vector<int> testV={5, 6, 7};
@@ -57,12 +114,147 @@ TEST_CASE("Test for_each copy array", "[Functional]"){
     std::vector<double> testarray={3, 4, 5};
     REQUIRE(futilities::for_each_copy(testarray, squareTestV)==std::vector<double>({27, 48, 75}));
 }
+TEST_CASE("Test jacobi_parallel matches for_each_copy", "[Functional]"){
+    auto averageTestV=[](const auto& val, const auto& index, const auto& arr){
+        return (index==0||index==arr.size()-1)?val:.5*(arr[index-1]+arr[index+1]);
+    };
+    std::vector<double> testarray={0, 3, 4, 5, 1};
+    auto expected=futilities::for_each_copy(testarray, averageTestV);
+    expected=futilities::for_each_copy(expected, averageTestV);
+    REQUIRE(futilities::jacobi_parallel(testarray, 2, averageTestV)==expected);
+}
+TEST_CASE("Test jacobi_parallel residual", "[Functional]"){
+    auto averageTestV=[](const auto& val, const auto& index, const auto& arr){
+        return (index==0||index==arr.size()-1)?val:.5*(arr[index-1]+arr[index+1]);
+    };
+    auto residualTestV=[](const auto& curr, const auto& prev){
+        return fabs(curr-prev);
+    };
+    int numSweeps=0;
+    auto keepGoing=[&](const auto& residual){
+        ++numSweeps;
+        return residual>1e-10;
+    };
+    std::vector<double> testarray(21, 0.0);
+    testarray.back()=1.0;
+    auto result=futilities::jacobi_parallel(std::move(testarray), 100000, averageTestV, residualTestV, keepGoing);
+    REQUIRE(numSweeps<100000);
+    for(int i=0; i<result.size(); ++i){
+        REQUIRE(result[i]==Approx(i/20.0).epsilon(1e-6));
+    }
+}
 TEST_CASE("Test for_emplace_back", "[Functional]"){
     auto valTestV=[](const auto& val){
         return val;
     };
     REQUIRE(futilities::for_emplace_back(0.0, 1.0, 5, valTestV)==std::vector<double>({0, .25, .5, .75, 1}));
 }
+TEST_CASE("Test for_emplace_back deduces type", "[Functional]"){
+    auto result=futilities::for_emplace_back(0.0, 1.0, 5, [](const auto& val){
+        return val>.5;
+    });
+    REQUIRE(result==std::vector<bool>({false, false, false, true, true}));
+}
+TEST_CASE("Test for_emplace_back_parallel", "[Functional]"){
+    auto valTestV=[](const auto& val){
+        return val;
+    };
+    REQUIRE(futilities::for_emplace_back_parallel(0.0, 1.0, 5, valTestV)==std::vector<double>({0, .25, .5, .75, 1}));
+    const int n=100003;
+    auto fn=[](const auto& val){
+        return val*val;
+    };
+    REQUIRE(futilities::for_emplace_back_parallel(-1.0, 2.0, n, fn)==futilities::for_emplace_back(-1.0, 2.0, n, fn));
+    auto asFloat=futilities::for_emplace_back_parallel(0.0, 1.0, 3, [](const auto& val){
+        return (float)val;
+    });
+    REQUIRE(asFloat==std::vector<float>({0.0f, .5f, 1.0f}));
+    REQUIRE(futilities::for_emplace_back_parallel(2.0, 3.0, 1, fn)==std::vector<double>({4.0}));
+    auto positive=futilities::for_emplace_back_parallel(-1.0, 1.0, n, [](const auto& val){
+        return val>0;
+    });
+    REQUIRE(positive.size()==n);
+    for(int i=0; i<n; ++i){
+        REQUIRE(positive[i]==(-1.0+2.0*i/(n-1)>0));
+    }
+}
+TEST_CASE("Test log_grid", "[Functional]"){
+    const int n=5001;
+    auto grid=futilities::log_grid(0.01, 100.0, n);
+    REQUIRE(grid.size()==n);
+    REQUIRE(grid.front()==0.01);
+    REQUIRE(grid.back()==100.0);
+    for(int i=0; i<n; ++i){
+        REQUIRE(grid[i]==Approx(0.01*std::pow(1e4, i/(double)(n-1))).epsilon(1e-13));
+    }
+    auto logs=futilities::log_grid(1.0f, 1024.0f, 11, [](const auto& val){
+        return std::log2(val);
+    });
+    for(int i=0; i<11; ++i){
+        REQUIRE(logs[i]==Approx(i).epsilon(1e-5));
+    }
+    REQUIRE(futilities::log_grid(0.01, 100.0, 1)==std::vector<double>({0.01}));
+}
+TEST_CASE("Test chebyshev_grid", "[Functional]"){
+    const int n=2049;
+    const double pi=3.14159265358979323846;
+    auto grid=futilities::chebyshev_grid(-2.0, 4.0, n);
+    REQUIRE(grid.front()==-2.0);
+    REQUIRE(grid.back()==4.0);
+    for(int i=0; i<n; ++i){
+        REQUIRE(std::abs(grid[i]-(1.0-3.0*std::cos(pi*i/(n-1))))<1e-14);
+    }
+    for(int i=1; i<n; ++i){
+        REQUIRE(grid[i]>grid[i-1]);
+    }
+    REQUIRE(futilities::chebyshev_grid(-1.0, 1.0, 3)==std::vector<double>({-1, 0, 1}));
+    REQUIRE(futilities::chebyshev_grid(-2.0, 4.0, 1)==std::vector<double>({-2.0}));
+}
+TEST_CASE("Test sinh_grid", "[Functional]"){
+    const int n=1001;
+    const double center=100.0;
+    const double intensity=5.0;
+    auto grid=futilities::sinh_grid(0.0, 300.0, center, intensity, n);
+    REQUIRE(grid.front()==0.0);
+    REQUIRE(grid.back()==300.0);
+    const double c1=std::asinh(-center/intensity);
+    const double c2=std::asinh(200.0/intensity);
+    for(int i=0; i<n; ++i){
+        const double expected=center+intensity*std::sinh(c1+(c2-c1)*i/(n-1));
+        REQUIRE(std::abs(grid[i]-expected)<1e-12*300.0);
+    }
+    //spacing is finest near the center
+    double smallestStep=grid[1]-grid[0];
+    int smallestIndex=0;
+    for(int i=1; i<n-1; ++i){
+        if(grid[i+1]-grid[i]<smallestStep){
+            smallestStep=grid[i+1]-grid[i];
+            smallestIndex=i;
+        }
+    }
+    REQUIRE(std::abs(grid[smallestIndex]-center)<smallestStep);
+    REQUIRE(futilities::sinh_grid(0.0, 300.0, center, intensity, 1)==std::vector<double>({0.0}));
+}
+TEST_CASE("Test for_emplace_back time", "[Functional]"){
+    const int n=10000000;
+    auto payoff=[](const auto& val){
+        return std::max(std::exp(val)-1.0, 0.0);
+    };
+    auto started = std::chrono::high_resolution_clock::now();
+    auto serial=futilities::for_emplace_back(-3.0, 3.0, n, payoff);
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout<<"Speed futilities for_emplace_back: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto parallel=futilities::for_emplace_back_parallel(-3.0, 3.0, n, payoff);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout<<"Speed futilities for_emplace_back_parallel: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(serial==parallel);
+    started = std::chrono::high_resolution_clock::now();
+    auto grid=futilities::log_grid(0.01, 100.0, n);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout<<"Speed futilities log_grid: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(grid.size()==n);
+}
 TEST_CASE("Test cumulative sum", "[Functional]"){
     std::vector<int> testV={5, 6, 7, 8, 9};
     auto valTestV=[](const auto& val, const auto& index){
@@ -84,6 +276,100 @@ TEST_CASE("Test sum", "[Functional]"){
     };
     REQUIRE(futilities::sum(testV, valTestV)==35);
 }
+TEST_CASE("Test kernels at every instruction set", "[Functional]"){
+    using futilities::kernels::isa;
+    int n=1003;
+    std::vector<double> x=futilities::for_each(0, n, [](const auto& index){
+        return 1.0+index%7;
+    });
+    std::vector<double> y(n, 2.0);
+    std::vector<float> xFloat(x.begin(), x.end());
+    double expectedSum=futilities::sum(x, [](const auto& val, const auto& index){
+        return val;
+    });
+    for(isa level: {isa::generic, isa::sse42, isa::avx2, isa::avx512}){
+        futilities::kernels::set_isa(level);
+        REQUIRE(futilities::kernels::sum(x.data(), n)==Approx(expectedSum));
+        REQUIRE(futilities::kernels::sum(xFloat.data(), n)==Approx(expectedSum));
+        REQUIRE(futilities::kernels::dot(x.data(), y.data(), n)==Approx(2*expectedSum));
+        REQUIRE(futilities::kernels::transform_reduce(x.data(), n, [](const auto& val){
+            return val*val;
+        })==Approx(futilities::kernels::dot(x.data(), x.data(), n)));
+        std::vector<double> scan(n);
+        futilities::kernels::inclusive_scan(x.data(), scan.data(), n);
+        REQUIRE(scan==futilities::cumulative_sum_copy(x, [](const auto& val, const auto& index){
+            return val;
+        }));
+        std::vector<double> axpy=y;
+        futilities::kernels::axpy(3.0, x.data(), axpy.data(), n);
+        REQUIRE(axpy[10]==2.0+3.0*x[10]);
+    }
+    futilities::kernels::set_isa(futilities::kernels::supported_isa());
+}
+TEST_CASE("Test sum with ops", "[Functional]"){
+    std::vector<double> testV={5, -6, 7, 8, 9};
+    std::vector<int> testVInt={5, -6, 7, 8, 9};
+    REQUIRE(futilities::sum(testV, futilities::ops::identity())==23);
+    REQUIRE(futilities::sum(testV, futilities::ops::square())==255);
+    REQUIRE(futilities::sum(testV, futilities::ops::abs())==35);
+    REQUIRE(futilities::sum(testV, futilities::ops::plus<double>(1.0))==28);
+    REQUIRE(futilities::sum(testV, futilities::ops::axpy<double>(2.0, 1.0))==51);
+    REQUIRE(futilities::sum(testVInt, futilities::ops::square())==255);
+    std::vector<double> large(100003, .5);
+    REQUIRE(futilities::sum(large, futilities::ops::square())==Approx(.25*100003));
+}
+TEST_CASE("Test for_each with ops", "[Functional]"){
+    std::vector<double> testV={5, -6, 7, 8, 9};
+    REQUIRE(futilities::for_each(std::move(testV), futilities::ops::axpy<double>(2.0, 1.0))==std::vector<double>({11, -11, 15, 17, 19}));
+    std::vector<float> testVFloat={5, -6, 7};
+    REQUIRE(futilities::for_each(std::move(testVFloat), futilities::ops::abs())==std::vector<float>({5, 6, 7}));
+    std::vector<int> testVInt={5, -6, 7};
+    REQUIRE(futilities::for_each(std::move(testVInt), futilities::ops::square())==std::vector<int>({25, 36, 49}));
+}
+TEST_CASE("Test sum with ops time", "[Functional]"){
+    int n=10000000;
+    std::vector<double> testV(n, .5);
+    auto started = std::chrono::high_resolution_clock::now();
+    double resultOps=futilities::sum(testV, futilities::ops::square());
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities sum ops::square: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    double resultLambda=futilities::sum(testV, [](const auto& val, const auto& index){
+        return val*val;
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities sum lambda: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(resultOps==Approx(resultLambda));
+}
+TEST_CASE("Test kernels time", "[Functional]"){
+    using futilities::kernels::isa;
+    int n=4096;
+    int repetitions=10000;
+    std::vector<double> x(n, 1.0);
+    std::vector<double> y(n, 1.0);
+    std::vector<std::string> names={"generic", "sse4.2", "avx2", "avx512"};
+    for(isa level: {isa::generic, isa::sse42, isa::avx2, isa::avx512}){
+        isa used=futilities::kernels::set_isa(level);
+        double result=0;
+        auto started = std::chrono::high_resolution_clock::now();
+        for(int r=0; r<repetitions; ++r){
+            result+=futilities::kernels::dot(x.data(), y.data(), n);
+        }
+        auto done = std::chrono::high_resolution_clock::now();
+        double seconds=std::chrono::duration<double>(done-started).count();
+        std::cout << "Speed kernels::dot "<<names[(int)level]<<" (runs "<<names[(int)used]<<"): "<<(double)n*repetitions/seconds*1e-9<<" Gelements/s"<<std::endl;
+
+        started = std::chrono::high_resolution_clock::now();
+        for(int r=0; r<repetitions; ++r){
+            result+=futilities::kernels::sum(x.data(), n);
+        }
+        done = std::chrono::high_resolution_clock::now();
+        seconds=std::chrono::duration<double>(done-started).count();
+        std::cout << "Speed kernels::sum "<<names[(int)level]<<" (runs "<<names[(int)used]<<"): "<<(double)n*repetitions/seconds*1e-9<<" Gelements/s"<<std::endl;
+        REQUIRE(result==2.0*n*repetitions);
+    }
+    futilities::kernels::set_isa(futilities::kernels::supported_isa());
+}
 TEST_CASE("Test sum iterator", "[Functional]"){
     //std::vector<int> testV={5, 6, 7, 8, 9};
     auto valTestV=[](const auto& val){
@@ -99,6 +385,1665 @@ TEST_CASE("Test sum nontrivial", "[Functional]"){
     REQUIRE(futilities::sum(5, 10, valTestV)==255);
 }
  
+TEST_CASE("Test zip_sum", "[Functional]"){
+    std::vector<int> a={1, 2, 3};
+    std::vector<double> b={4, 5, 6};
+    std::vector<double> c={1, 0, 2};
+    REQUIRE(futilities::zip_sum(a, b, [](const auto& x, const auto& y, const auto& index){
+        return x*y;
+    })==32);
+    REQUIRE(futilities::zip_sum(a, b, c, [](const auto& x, const auto& y, const auto& z, const auto& index){
+        return x*y*z+index;
+    })==43);
+    std::vector<double> large(10001, 2.0);
+    REQUIRE(futilities::zip_sum(large, large, [](const auto& x, const auto& y, const auto& index){
+        return x*y;
+    })==40004);
+    //empty arrays sum to zero whether or not the type is arithmetic
+    std::vector<std::complex<double>> none;
+    REQUIRE(futilities::zip_sum(none, none, [](const auto& x, const auto& y, const auto& index){
+        return x*y;
+    })==std::complex<double>(0));
+    REQUIRE(futilities::dot(none, none)==std::complex<double>(0));
+    REQUIRE(futilities::dot(std::vector<double>(), std::vector<double>())==0);
+}
+TEST_CASE("Test zip_for_each and zip_transform_copy", "[Functional]"){
+    std::vector<double> a={1, 2, 3};
+    std::vector<double> b={4, 5, 6};
+    auto addTestV=[](const auto& x, const auto& y, const auto& index){
+        return x+y+index;
+    };
+    REQUIRE(futilities::zip_transform_copy(a, b, addTestV)==std::vector<double>({5, 8, 11}));
+    REQUIRE(futilities::zip_for_each(std::move(a), b, addTestV)==std::vector<double>({5, 8, 11}));
+}
+TEST_CASE("Test dot and weighted_sum", "[Functional]"){
+    std::vector<double> a={1, 2, 3};
+    std::vector<double> b={4, 5, 6};
+    std::vector<int> c={4, 5, 6};
+    REQUIRE(futilities::dot(a, b)==32);
+    REQUIRE(futilities::dot(a, c)==32);
+    std::deque<double> d={4, 5, 6};
+    REQUIRE(futilities::dot(a, d)==32);
+    REQUIRE(futilities::dot(d, a)==32);
+    REQUIRE(futilities::weighted_sum(a, b, [](const auto& val, const auto& index){
+        return val*val;
+    })==1*16+2*25+3*36);
+    std::vector<float> large(100003, 2.0f);
+    REQUIRE(futilities::dot(large, large)==Approx(400012));
+}
+TEST_CASE("Test dot time", "[Functional]"){
+    int n=10000000;
+    std::vector<double> a(n, .5);
+    std::vector<double> b(n, 2.0);
+    auto started = std::chrono::high_resolution_clock::now();
+    double resultDot=futilities::dot(a, b);
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities dot: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+
+    started = std::chrono::high_resolution_clock::now();
+    double resultZip=futilities::zip_sum(a, b, [](const auto& x, const auto& y, const auto& index){
+        return x*y;
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities zip_sum: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+
+    started = std::chrono::high_resolution_clock::now();
+    double resultCapture=futilities::sum(a, [&](const auto& val, const auto& index){
+        return val*b[index];
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities sum with captured array: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(resultDot==Approx(resultCapture));
+    REQUIRE(resultZip==Approx(resultCapture));
+}
+TEST_CASE("Test complex_array conversions", "[Functional]"){
+    std::vector<std::complex<double> > testV={{1, 2}, {3, -4}, {0, 1}};
+    futilities::complex_array<double> split(testV);
+    REQUIRE(split.size()==3);
+    REQUIRE(split.real==std::vector<double>({1, 3, 0}));
+    REQUIRE(split.imag==std::vector<double>({2, -4, 1}));
+    REQUIRE(split[1]==std::complex<double>(3, -4));
+    REQUIRE(split.to_vector()==testV);
+}
+TEST_CASE("Test complex_array for_each, sum and cumulative_sum", "[Functional]"){
+    std::vector<std::complex<double> > testV={{1, 2}, {3, -4}, {0, 1}};
+    auto squareTestV=[](const auto& val, const auto& index){
+        return val*val+(double)index;
+    };
+    auto expected=futilities::for_each(std::vector<std::complex<double> >(testV), squareTestV);
+    futilities::complex_array<double> split(testV);
+    REQUIRE(futilities::sum(split, squareTestV)==futilities::sum(expected, [](const auto& val, const auto& index){
+        return val;
+    }));
+    REQUIRE(futilities::for_each(split, squareTestV).to_vector()==expected);
+    auto cumulative=futilities::cumulative_sum(futilities::complex_array<double>(testV), [](const auto& val, const auto& index){
+        return val;
+    });
+    REQUIRE(cumulative.to_vector()==std::vector<std::complex<double> >({{1, 2}, {4, -2}, {4, -1}}));
+}
+TEST_CASE("Test complex kernels", "[Functional]"){
+    int n=1001;
+    std::vector<std::complex<double> > a(n), b(n);
+    for(int i=0; i<n; ++i){
+        a[i]=std::complex<double>(.001*i, 1.0-.002*i);
+        b[i]=std::complex<double>(-.5+.001*i, .003*i);
+    }
+    futilities::complex_array<double> splitA(a), splitB(b);
+    std::complex<double> expectedAccumulate(0, 0), expectedFused(0, 0);
+    for(int i=0; i<n; ++i){
+        expectedAccumulate+=a[i];
+        expectedFused+=a[i]*b[i];
+    }
+    auto accumulated=futilities::complex_accumulate(splitA);
+    REQUIRE(accumulated.real()==Approx(expectedAccumulate.real()));
+    REQUIRE(accumulated.imag()==Approx(expectedAccumulate.imag()));
+    auto fused=futilities::complex_multiply_accumulate(splitA, splitB);
+    REQUIRE(fused.real()==Approx(expectedFused.real()));
+    REQUIRE(fused.imag()==Approx(expectedFused.imag()));
+
+    auto multiplied=futilities::complex_multiply(futilities::complex_array<double>(splitA), splitB);
+    auto scaled=futilities::complex_multiply(futilities::complex_array<double>(splitA), std::complex<double>(2, -1));
+    auto exponentiated=futilities::complex_exp(futilities::complex_array<double>(splitA));
+    for(int i=0; i<n; ++i){
+        REQUIRE(multiplied[i].real()==Approx(std::real(a[i]*b[i])));
+        REQUIRE(multiplied[i].imag()==Approx(std::imag(a[i]*b[i])));
+        REQUIRE(scaled[i].real()==Approx(std::real(a[i]*std::complex<double>(2, -1))));
+        REQUIRE(scaled[i].imag()==Approx(std::imag(a[i]*std::complex<double>(2, -1))));
+        REQUIRE(exponentiated[i].real()==Approx(std::real(std::exp(a[i]))));
+        REQUIRE(exponentiated[i].imag()==Approx(std::imag(std::exp(a[i]))));
+    }
+}
+TEST_CASE("Test complex_array time", "[Functional]"){
+    int n=1000000;
+    std::vector<std::complex<double> > a(n, std::complex<double>(.5, .25));
+    std::vector<std::complex<double> > b(n, std::complex<double>(1.5, -.5));
+    futilities::complex_array<double> splitA(a), splitB(b);
+    auto started = std::chrono::high_resolution_clock::now();
+    auto interleaved=futilities::sum(a, [&](const auto& val, const auto& index){
+        return val*b[index];
+    });
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed interleaved complex multiply accumulate: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto split=futilities::complex_multiply_accumulate(splitA, splitB);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities complex_multiply_accumulate: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(split.real()==Approx(interleaved.real()));
+    REQUIRE(split.imag()==Approx(interleaved.imag()));
+}
+TEST_CASE("Test batched_sum", "[Functional]"){
+    std::vector<double> points={.5, 1.0, 2.0};
+    auto result=futilities::batched_sum(points, 4, [](const auto& x, const auto& k){
+        return x*k;
+    });
+    REQUIRE(result==std::vector<double>({3, 6, 12}));
+}
+TEST_CASE("Test fourier_cosine_sum", "[Functional]"){
+    int numPoints=1001;
+    int numTerms=1500;
+    double a=-3.0;
+    double du=M_PI/6.0;
+    std::vector<double> points(numPoints);
+    std::vector<double> coefs(numTerms);
+    for(int j=0; j<numPoints; ++j){
+        points[j]=a+6.0*j/(numPoints-1);
+    }
+    for(int k=0; k<numTerms; ++k){
+        coefs[k]=1.0/(1.0+k);
+    }
+    auto result=futilities::fourier_cosine_sum(points, coefs, du, a);
+    for(int j=0; j<numPoints; ++j){
+        double expected=futilities::sum(0, numTerms, [&](const auto& k){
+            return coefs[k]*cos(du*k*(points[j]-a));
+        });
+        REQUIRE(result[j]==Approx(expected));
+    }
+}
+TEST_CASE("Test fourier_cosine_sum time", "[Functional]"){
+    int numPoints=4096;
+    int numTerms=256;
+    double a=-3.0;
+    double du=M_PI/6.0;
+    std::vector<double> points(numPoints);
+    std::vector<double> coefs(numTerms, .5);
+    for(int j=0; j<numPoints; ++j){
+        points[j]=a+6.0*j/(numPoints-1);
+    }
+    auto started = std::chrono::high_resolution_clock::now();
+    auto naive=futilities::for_each(std::vector<double>(points), [&](const auto& x, const auto& index){
+        return futilities::sum(0, numTerms, [&](const auto& k){
+            return coefs[k]*cos(du*k*(x-a));
+        });
+    });
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed sum per point: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto batched=futilities::fourier_cosine_sum(points, coefs, du, a);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities fourier_cosine_sum: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    for(int j=0; j<numPoints; j+=97){
+        REQUIRE(batched[j]==Approx(naive[j]));
+    }
+}
+template<typename T>
+std::vector<std::complex<T> > naive_dft(const std::vector<std::complex<T> >& x, double sign){
+    const int n=x.size();
+    std::vector<std::complex<T> > result(n);
+    for(int k=0; k<n; ++k){
+        result[k]=futilities::sum(0, n, [&](const auto& j){
+            const double angle=sign*2.0*M_PI*(double)(((long long)j*k)%n)/n;
+            return x[j]*std::complex<T>(cos(angle), sin(angle));
+        });
+    }
+    return result;
+}
+template<typename T>
+std::vector<std::complex<T> > fft_test_signal(int n){
+    std::vector<std::complex<T> > x(n);
+    for(int j=0; j<n; ++j){
+        x[j]=std::complex<T>(cos(.3*j)+.01*j, sin(.7*j*j));
+    }
+    return x;
+}
+TEST_CASE("Test fft matches dft", "[Functional]"){
+    for(int n:{1, 2, 3, 4, 5, 6, 7, 8, 9, 12, 15, 16, 30, 49, 64, 97, 128, 210, 251, 1000, 1024, 4096}){
+        auto x=fft_test_signal<double>(n);
+        auto expected=naive_dft(x, -1.0);
+        auto result=futilities::fft::forward_copy(x);
+        auto expectedInverse=naive_dft(x, 1.0);
+        auto resultInverse=futilities::fft::inverse_copy(x);
+        for(int k=0; k<n; ++k){
+            REQUIRE(std::abs(result[k]-expected[k])<1e-9*n);
+            REQUIRE(std::abs(resultInverse[k]*(double)n-expectedInverse[k])<1e-9*n);
+        }
+        auto roundTrip=futilities::fft::inverse(futilities::fft::forward_copy(x));
+        for(int k=0; k<n; ++k){
+            REQUIRE(std::abs(roundTrip[k]-x[k])<1e-12*n);
+        }
+    }
+}
+TEST_CASE("Test fft large parallel and float", "[Functional]"){
+    int n=1<<16;
+    auto x=fft_test_signal<double>(n);
+    auto roundTrip=futilities::fft::inverse(futilities::fft::forward_copy(x));
+    for(int k=0; k<n; k+=101){
+        REQUIRE(std::abs(roundTrip[k]-x[k])<1e-10);
+    }
+    auto xFloat=fft_test_signal<float>(48);
+    auto expected=naive_dft(xFloat, -1.0);
+    auto result=futilities::fft::forward_copy(xFloat);
+    for(int k=0; k<48; ++k){
+        REQUIRE(std::abs(result[k]-expected[k])<1e-3);
+    }
+}
+TEST_CASE("Test fft real", "[Functional]"){
+    for(int n:{1, 2, 3, 8, 11, 30, 97, 1024}){
+        auto x=fft_test_signal<double>(n);
+        std::vector<double> real(n);
+        for(int j=0; j<n; ++j){
+            real[j]=x[j].real();
+            x[j]=real[j];
+        }
+        auto expected=futilities::fft::forward(std::move(x));
+        auto result=futilities::fft::forward_real(real);
+        REQUIRE(result.size()==n/2+1);
+        for(int k=0; k<=n/2; ++k){
+            REQUIRE(std::abs(result[k]-expected[k])<1e-9*n);
+        }
+        auto roundTrip=futilities::fft::inverse_real(result, n);
+        for(int j=0; j<n; ++j){
+            REQUIRE(std::abs(roundTrip[j]-real[j])<1e-12*n);
+        }
+    }
+}
+TEST_CASE("Test fft batch and plan cache", "[Functional]"){
+    std::vector<std::vector<std::complex<double> > > arrays;
+    for(int n:{16, 16, 100, 7, 16}){
+        arrays.push_back(fft_test_signal<double>(n));
+    }
+    auto expected=arrays;
+    auto result=futilities::fft::transform_batch(std::move(arrays));
+    for(int i=0; i<(int)result.size(); ++i){
+        auto single=futilities::fft::forward(std::move(expected[i]));
+        for(int k=0; k<(int)single.size(); ++k){
+            REQUIRE(std::abs(result[i][k]-single[k])<1e-12);
+        }
+    }
+    REQUIRE(futilities::fft::get_plan<double>(16)==futilities::fft::get_plan<double>(16));
+    REQUIRE(futilities::fft::get_plan<double>(16)->size()==16);
+}
+TEST_CASE("Test fft time", "[Functional]"){
+    for(int n=256; n<=(1<<22); n*=4){
+        auto x=fft_test_signal<double>(n);
+        auto started = std::chrono::high_resolution_clock::now();
+        auto result=futilities::fft::forward(std::move(x));
+        auto done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed futilities fft n="<<n<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+        if(n<=1024){
+            auto y=fft_test_signal<double>(n);
+            started = std::chrono::high_resolution_clock::now();
+            auto nested=naive_dft(y, -1.0);
+            done = std::chrono::high_resolution_clock::now();
+            std::cout << "Speed nested sum dft n="<<n<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+            REQUIRE(std::abs(nested[n/3]-result[n/3])<1e-8*n);
+        }
+    }
+}
+std::vector<double> naive_convolve(const std::vector<double>& signal, const std::vector<double>& kernel){
+    const int n=signal.size();
+    const int k=kernel.size();
+    std::vector<double> result(n+k-1, 0.0);
+    for(int i=0; i<n+k-1; ++i){
+        for(int j=0; j<k; ++j){
+            if(i-j>=0&&i-j<n){
+                result[i]+=kernel[j]*signal[i-j];
+            }
+        }
+    }
+    return result;
+}
+TEST_CASE("Test convolve matches nested sum", "[Functional]"){
+    using futilities::convolution_mode;
+    using futilities::convolution_method;
+    for(int n:{1, 10, 1000, 10000}){
+        for(int k:{1, 3, 65, 200}){
+            std::vector<double> signal(n), kernel(k);
+            for(int i=0; i<n; ++i){
+                signal[i]=sin(.1*i)+.001*i;
+            }
+            for(int j=0; j<k; ++j){
+                kernel[j]=1.0/(1.0+j);
+            }
+            auto full=naive_convolve(signal, kernel);
+            for(auto method:{convolution_method::automatic, convolution_method::direct, convolution_method::fft}){
+                auto result=futilities::convolve(signal, kernel, convolution_mode::full, method);
+                REQUIRE(result.size()==full.size());
+                for(int i=0; i<(int)full.size(); ++i){
+                    REQUIRE(result[i]==Approx(full[i]).epsilon(1e-9));
+                }
+                auto same=futilities::convolve(signal, kernel, convolution_mode::same, method);
+                REQUIRE(same.size()==n);
+                for(int i=0; i<n; ++i){
+                    REQUIRE(same[i]==Approx(full[i+(k-1)/2]).epsilon(1e-9));
+                }
+                auto valid=futilities::convolve(signal, kernel, convolution_mode::valid, method);
+                REQUIRE(valid.size()==std::max(n-k+1, 0));
+                for(int i=0; i<(int)valid.size(); ++i){
+                    REQUIRE(valid[i]==Approx(full[i+k-1]).epsilon(1e-9));
+                }
+            }
+        }
+    }
+}
+TEST_CASE("Test convolve generalises for_each_exclude_last", "[Functional]"){
+    std::vector<int> testV={5, 6, 7, 8, 9};
+    auto expected=futilities::for_each_exclude_last(std::vector<int>(testV), [](const auto& curr, const auto& next, const auto& index){
+        return 2*curr+3*next;
+    });
+    REQUIRE(futilities::convolve(testV, std::vector<int>({3, 2}), futilities::convolution_mode::valid)==expected);
+    REQUIRE(futilities::correlate(testV, std::vector<int>({2, 3}), futilities::convolution_mode::valid)==expected);
+    REQUIRE(futilities::correlate(testV, std::vector<int>({1, 1}))==std::vector<int>({5, 11, 13, 15, 17, 9}));
+}
+TEST_CASE("Test convolve time", "[Functional]"){
+    int n=1000000;
+    std::vector<double> signal(n);
+    for(int i=0; i<n; ++i){
+        signal[i]=sin(.1*i);
+    }
+    for(int k:{5, 1000}){
+        std::vector<double> kernel(k, 1.0/k);
+        auto started = std::chrono::high_resolution_clock::now();
+        auto nested=futilities::for_each(std::vector<double>(n-k+1), [&](const auto& val, const auto& index){
+            return futilities::sum(0, k, [&](const auto& j){
+                return kernel[j]*signal[index+k-1-j];
+            });
+        });
+        auto done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed sum in for_each k="<<k<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+        started = std::chrono::high_resolution_clock::now();
+        auto result=futilities::convolve(signal, kernel, futilities::convolution_mode::valid);
+        done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed futilities convolve k="<<k<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+        for(int i=0; i<n-k+1; i+=9973){
+            REQUIRE(result[i]==Approx(nested[i]));
+        }
+    }
+}
+TEST_CASE("Test tridiagonal_solve", "[Functional]"){
+    std::vector<double> lower={0, 1, 2, 1};
+    std::vector<double> diagonal={4, 5, 6, 4};
+    std::vector<double> upper={1, 2, 1, 0};
+    std::vector<double> expected={1, -2, 3, .5};
+    std::vector<double> rhs(4);
+    for(int i=0; i<4; ++i){
+        rhs[i]=diagonal[i]*expected[i]+(i>0?lower[i]*expected[i-1]:0)+(i<3?upper[i]*expected[i+1]:0);
+    }
+    auto result=futilities::tridiagonal_solve(lower, diagonal, upper, std::move(rhs));
+    for(int i=0; i<4; ++i){
+        REQUIRE(result[i]==Approx(expected[i]));
+    }
+}
+TEST_CASE("Test interpolation linear", "[Functional]"){
+    auto values=futilities::for_emplace_back(0.0, 2.0, 5, [](const auto& x){
+        return 3.0*x-1.0;
+    });
+    auto interpolator=futilities::interpolation::linear(0.0, 2.0, values);
+    REQUIRE(interpolator.size()==4);
+    for(double x:{0.0, .1, .5, .77, 1.3, 2.0, -1.0, 3.0}){
+        REQUIRE(interpolator(x)==Approx(3.0*x-1.0));
+    }
+    auto tent=futilities::interpolation::linear(0.0, 2.0, std::vector<double>({0, 1, 0}));
+    REQUIRE(tent(.5)==Approx(.5));
+    REQUIRE(tent(1.5)==Approx(.5));
+    REQUIRE(std::isnan(tent(std::numeric_limits<double>::quiet_NaN())));
+    auto nans=tent.evaluate(std::vector<double>(5, std::numeric_limits<double>::quiet_NaN()));
+    for(auto val:nans){
+        REQUIRE(std::isnan(val));
+    }
+}
+TEST_CASE("Test interpolation passes through nodes", "[Functional]"){
+    const int n=101;
+    auto values=futilities::for_emplace_back(-1.0, 4.0, n, [](const auto& x){
+        return std::exp(-x*x)+x;
+    });
+    auto linear=futilities::interpolation::linear(-1.0, 4.0, values);
+    auto monotone=futilities::interpolation::monotone_cubic(-1.0, 4.0, values);
+    auto spline=futilities::interpolation::natural_spline(-1.0, 4.0, values);
+    for(int i=0; i<n; ++i){
+        const double x=-1.0+5.0*i/(n-1);
+        REQUIRE(linear(x)==Approx(values[i]));
+        REQUIRE(monotone(x)==Approx(values[i]));
+        REQUIRE(spline(x)==Approx(values[i]));
+    }
+}
+TEST_CASE("Test natural_spline accuracy", "[Functional]"){
+    const double pi=3.14159265358979323846;
+    auto error=[&](int n){
+        auto values=futilities::for_emplace_back(0.0, pi, n, [](const auto& x){
+            return std::sin(x);
+        });
+        //sin has zero second derivative at both ends, matching the natural spline
+        auto spline=futilities::interpolation::natural_spline(0.0, pi, values);
+        double maxError=0;
+        for(int i=0; i<1000; ++i){
+            const double x=pi*i/999.0;
+            maxError=std::max(maxError, std::abs(spline(x)-std::sin(x)));
+        }
+        return maxError;
+    };
+    const double coarse=error(21);
+    const double fine=error(41);
+    REQUIRE(coarse<1e-4);
+    //fourth order convergence
+    REQUIRE(coarse/fine>12.0);
+    auto line=futilities::interpolation::natural_spline(0.0, 1.0, std::vector<double>({1, 2, 3, 4}));
+    REQUIRE(line(.4)==Approx(2.2));
+}
+TEST_CASE("Test monotone_cubic does not overshoot", "[Functional]"){
+    std::vector<double> step={0, 0, 0, 1, 1, 1};
+    auto monotone=futilities::interpolation::monotone_cubic(0.0, 5.0, step);
+    auto spline=futilities::interpolation::natural_spline(0.0, 5.0, step);
+    double previous=monotone(0.0);
+    bool splineOvershoots=false;
+    for(int i=1; i<=500; ++i){
+        const double x=5.0*i/500.0;
+        const double val=monotone(x);
+        REQUIRE(val>=previous);
+        REQUIRE(val>=0.0);
+        REQUIRE(val<=1.0);
+        previous=val;
+        splineOvershoots=splineOvershoots||spline(x)>1.0||spline(x)<0.0;
+    }
+    REQUIRE(splineOvershoots);
+}
+TEST_CASE("Test interpolation evaluate", "[Functional]"){
+    auto values=futilities::for_emplace_back(0.0, 10.0, 1001, [](const auto& x){
+        return std::sqrt(x);
+    });
+    auto spline=futilities::interpolation::natural_spline(0.0, 10.0, values);
+    const int n=100003;
+    auto xs=futilities::for_emplace_back(-.5, 10.5, n, [](const auto& x){
+        return x;
+    });
+    auto result=spline.evaluate(xs);
+    REQUIRE(result.size()==n);
+    for(int i=0; i<n; ++i){
+        REQUIRE(result[i]==spline(xs[i]));
+    }
+}
+TEST_CASE("Test interpolation time", "[Functional]"){
+    const int numNodes=10001;
+    const int n=1000000;
+    auto grid=futilities::for_emplace_back(0.0, 1.0, numNodes, [](const auto& x){
+        return x;
+    });
+    auto values=futilities::for_each_copy(grid, [](const auto& x, const auto& index, const auto& array){
+        return std::exp(x);
+    });
+    std::vector<double> xs(n);
+    for(int i=0; i<n; ++i){
+        xs[i]=std::fmod(i*0.6180339887498949, 1.0);
+    }
+    auto started = std::chrono::high_resolution_clock::now();
+    auto searched=futilities::for_each_copy(xs, [&](const auto& x, const auto& index, const auto& array){
+        const int j=std::min((int)(std::upper_bound(grid.begin(), grid.end(), x)-grid.begin()), numNodes-1)-1;
+        const double u=(x-grid[j])/(grid[j+1]-grid[j]);
+        return values[j]+u*(values[j+1]-values[j]);
+    });
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed binary search linear interpolation: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    auto linear=futilities::interpolation::linear(0.0, 1.0, values);
+    started = std::chrono::high_resolution_clock::now();
+    auto result=linear.evaluate(xs);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities interpolation linear: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    for(int i=0; i<n; i+=997){
+        REQUIRE(result[i]==Approx(searched[i]));
+    }
+    auto spline=futilities::interpolation::natural_spline(0.0, 1.0, values);
+    started = std::chrono::high_resolution_clock::now();
+    result=spline.evaluate(xs);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities interpolation natural_spline: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+}
+TEST_CASE("Test chebyshev approximate polynomial", "[Functional]"){
+    //2x^3-x is 0.5*T_3+0.5*T_1 on [-1, 1]
+    auto proxy=futilities::chebyshev::approximate(-1.0, 1.0, [](const auto& x){
+        return 2.0*x*x*x-x;
+    });
+    REQUIRE(proxy.degree()==3);
+    const auto& coefficients=proxy.get_coefficients();
+    REQUIRE(std::abs(coefficients[0])<1e-15);
+    REQUIRE(coefficients[1]==Approx(.5));
+    REQUIRE(std::abs(coefficients[2])<1e-15);
+    REQUIRE(coefficients[3]==Approx(.5));
+    auto shifted=futilities::chebyshev::approximate(2.0, 5.0, [](const auto& x){
+        return x*x-3.0;
+    });
+    REQUIRE(shifted.degree()==2);
+    for(double x:{2.0, 2.5, 3.7, 5.0}){
+        REQUIRE(shifted(x)==Approx(x*x-3.0));
+    }
+}
+TEST_CASE("Test chebyshev approximate accuracy", "[Functional]"){
+    auto fn=[](const auto& x){
+        return std::exp(-x)*std::sin(5.0*x)+1.0/(1.0+x*x);
+    };
+    //the tolerance is relative to the largest sample, about exp(3)
+    const double scale=std::exp(3.0);
+    for(double tolerance:{1e-6, 1e-10, 1e-14}){
+        auto proxy=futilities::chebyshev::approximate(-3.0, 4.0, fn, tolerance);
+        for(int i=0; i<=1000; ++i){
+            const double x=-3.0+7.0*i/1000.0;
+            REQUIRE(std::abs(proxy(x)-fn(x))<10.0*tolerance*scale);
+        }
+    }
+    auto coarse=futilities::chebyshev::approximate(-3.0, 4.0, fn, 1e-6);
+    auto fine=futilities::chebyshev::approximate(-3.0, 4.0, fn, 1e-14);
+    REQUIRE(coarse.degree()<fine.degree());
+    auto limited=futilities::chebyshev::approximate(-3.0, 4.0, fn, 1e-14, 32);
+    REQUIRE(limited.degree()<=32);
+    for(int maxDegree:{1, 5, 8}){
+        auto low=futilities::chebyshev::approximate(-3.0, 4.0, fn, 1e-14, maxDegree);
+        REQUIRE(low.degree()<=maxDegree);
+    }
+    auto line=futilities::chebyshev::approximate(0.0, 1.0, [](const auto& x){
+        return 2.0*x+1.0;
+    }, 1e-14, 4);
+    REQUIRE(line.degree()==1);
+    REQUIRE(line(.3)==Approx(1.6));
+}
+TEST_CASE("Test chebyshev proxy in futilities functions", "[Functional]"){
+    auto fn=[](const auto& x){
+        return std::cos(x);
+    };
+    auto proxy=futilities::chebyshev::approximate(0.0, 100.0, fn);
+    auto values=futilities::for_each_parallel(0, 101, proxy);
+    for(int i=0; i<101; ++i){
+        REQUIRE(std::abs(values[i]-std::cos(i))<1e-12);
+    }
+    REQUIRE(futilities::sum(0, 101, proxy)==Approx(futilities::sum(0, 101, fn)));
+    auto mapped=futilities::for_each(std::vector<double>({.5, 1.5}), proxy);
+    REQUIRE(std::abs(mapped[1]-std::cos(1.5))<1e-12);
+    auto xs=futilities::for_emplace_back(-1.0, 101.0, 5001, [](const auto& x){
+        return x;
+    });
+    auto batch=proxy.evaluate(xs);
+    for(int i=0; i<5001; ++i){
+        REQUIRE(batch[i]==Approx(proxy(xs[i])).epsilon(1e-12));
+    }
+}
+TEST_CASE("Test chebyshev time", "[Functional]"){
+    //a nested integral: the laplace transform of 1/(1+u^2) on [0, 1]
+    const int numInner=400;
+    auto expensive=[&](const auto& x){
+        return futilities::sum(0, numInner, [&](const auto& j){
+            const double u=(j+.5)/numInner;
+            return std::exp(-x*u)/(1.0+u*u);
+        })/numInner;
+    };
+    const int n=200000;
+    auto started = std::chrono::high_resolution_clock::now();
+    auto direct=futilities::for_each_parallel(0, n, [&](const auto& i){
+        return expensive(10.0*i/n);
+    });
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed expensive lambda in for_each_parallel: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto proxy=futilities::chebyshev::approximate(0.0, 10.0, expensive, 1e-13);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities chebyshev approximate degree "<<proxy.degree()<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto viaProxy=futilities::for_each_parallel(0, n, [&](const auto& i){
+        return proxy(10.0*i/n);
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities chebyshev proxy in for_each_parallel: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    auto xs=futilities::for_emplace_back_parallel(0.0, 10.0*(n-1)/n, n);
+    started = std::chrono::high_resolution_clock::now();
+    auto batch=proxy.evaluate(xs);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities chebyshev proxy evaluate: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    double maxError=0;
+    for(int i=0; i<n; ++i){
+        maxError=std::max(maxError, std::abs(viaProxy[i]-direct[i]));
+        maxError=std::max(maxError, std::abs(batch[i]-direct[i]));
+    }
+    std::cout << "Max error futilities chebyshev proxy: "<<maxError<<std::endl;
+    REQUIRE(maxError<1e-12);
+}
+TEST_CASE("Test quadrature trapezoid and simpson", "[Functional]"){
+    const double pi=3.14159265358979323846;
+    auto fn=[](const auto& x){
+        return std::sin(x);
+    };
+    REQUIRE(futilities::quadrature::trapezoid(0.0, pi, 1000, fn)==Approx(2.0).epsilon(1e-6));
+    REQUIRE(futilities::quadrature::simpson(0.0, pi, 1000, fn)==Approx(2.0).epsilon(1e-12));
+    //odd n rounds up
+    REQUIRE(futilities::quadrature::simpson(0.0, 1.0, 3, [](const auto& x){
+        return x*x*x;
+    })==Approx(.25));
+    //no intervals rounds up to the fewest the rule needs
+    auto line=[](const auto& x){
+        return 2*x;
+    };
+    REQUIRE(futilities::quadrature::trapezoid(0.0, 1.0, 0, line)==Approx(1.0));
+    REQUIRE(futilities::quadrature::simpson(0.0, 1.0, 0, line)==Approx(1.0));
+    REQUIRE(futilities::quadrature::integrate(futilities::quadrature::trapezoid_rule(0.0, 1.0, 0), line)==Approx(1.0));
+    REQUIRE(futilities::quadrature::integrate(futilities::quadrature::simpson_rule(0.0, 1.0, 0), line)==Approx(1.0));
+    //matches the hand written rule
+    const int n=100000;
+    const double h=pi/n;
+    auto byHand=futilities::sum(0, n+1, [&](const auto& i){
+        return (i==0||i==n?.5:1.0)*fn(i*h);
+    })*h;
+    REQUIRE(futilities::quadrature::trapezoid(0.0, pi, n, fn)==Approx(byHand).epsilon(1e-13));
+}
+TEST_CASE("Test quadrature gauss_legendre", "[Functional]"){
+    //exact for polynomials of degree 2*order-1
+    for(int order:{1, 2, 3, 5, 8}){
+        REQUIRE(futilities::quadrature::gauss_legendre(-1.0, 2.0, order, [&](const auto& x){
+            return futilities::int_power(x, 2*order-1)+1.0;
+        })==Approx((std::pow(2.0, 2*order)-1.0)/(2*order)+3.0).epsilon(1e-13));
+    }
+    auto rule=futilities::quadrature::get_gauss_legendre<double>(20);
+    REQUIRE(rule==futilities::quadrature::get_gauss_legendre<double>(20));
+    REQUIRE(futilities::sum(rule->weights, [](const auto& w, const auto& i){
+        return w;
+    })==Approx(2.0));
+    for(int i=1; i<20; ++i){
+        REQUIRE(rule->nodes[i]>rule->nodes[i-1]);
+        REQUIRE(rule->nodes[i]==Approx(-rule->nodes[19-i]));
+    }
+    REQUIRE(futilities::quadrature::gauss_legendre(0.0, 10.0, 10, [](const auto& x){
+        return std::exp(-x);
+    }, 8)==Approx(1.0-std::exp(-10.0)).epsilon(1e-14));
+    REQUIRE(futilities::quadrature::gauss_legendre(0.0f, 1.0f, 4, [](const auto& x){
+        return x*x;
+    })==Approx(1.0/3.0).epsilon(1e-6));
+    //large orders stay accurate
+    REQUIRE(futilities::quadrature::gauss_legendre(0.0, 100.0, 200, [](const auto& x){
+        return std::cos(x);
+    })==Approx(std::sin(100.0)).epsilon(1e-12));
+}
+TEST_CASE("Test quadrature tanh_sinh", "[Functional]"){
+    REQUIRE(futilities::quadrature::tanh_sinh(0.0, 1.0, [](const auto& x){
+        return 1.0/std::sqrt(x);
+    })==Approx(2.0).epsilon(1e-10));
+    REQUIRE(futilities::quadrature::tanh_sinh(0.0, 1.0, [](const auto& x){
+        return std::log(x);
+    })==Approx(-1.0).epsilon(1e-10));
+    REQUIRE(futilities::quadrature::tanh_sinh(-1.0, 1.0, [](const auto& x){
+        return std::sqrt(1.0-x*x);
+    })==Approx(3.14159265358979323846/2.0).epsilon(1e-12));
+}
+TEST_CASE("Test quadrature rules and integrate", "[Functional]"){
+    auto fn=[](const auto& x){
+        return std::exp(x);
+    };
+    const double exact=std::exp(2.0)-1.0;
+    REQUIRE(futilities::quadrature::integrate(futilities::quadrature::trapezoid_rule(0.0, 2.0, 500), fn)==
+        Approx(futilities::quadrature::trapezoid(0.0, 2.0, 500, fn)).epsilon(1e-13));
+    REQUIRE(futilities::quadrature::integrate(futilities::quadrature::simpson_rule(0.0, 2.0, 500), fn)==
+        Approx(futilities::quadrature::simpson(0.0, 2.0, 500, fn)).epsilon(1e-13));
+    REQUIRE(futilities::quadrature::integrate(futilities::quadrature::gauss_legendre_rule(0.0, 2.0, 12, 3), fn)==Approx(exact).epsilon(1e-14));
+    auto tanhSinh=futilities::quadrature::tanh_sinh_rule(0.0, 2.0, 5);
+    REQUIRE(futilities::quadrature::integrate(tanhSinh, fn)==Approx(exact).epsilon(1e-13));
+}
+TEST_CASE("Test quadrature integrate_batch", "[Functional]"){
+    const int numParams=1000;
+    std::vector<double> lambdas(numParams);
+    for(int i=0; i<numParams; ++i){
+        lambdas[i]=.01+i*.01;
+    }
+    auto rule=futilities::quadrature::gauss_legendre_rule(0.0, 1.0, 16, 4);
+    auto result=futilities::quadrature::integrate_batch(rule, lambdas, [](const auto& x, const auto& lambda){
+        return std::exp(-lambda*x);
+    });
+    REQUIRE(result.size()==numParams);
+    for(int i=0; i<numParams; ++i){
+        REQUIRE(result[i]==Approx((1.0-std::exp(-lambdas[i]))/lambdas[i]).epsilon(1e-13));
+    }
+}
+TEST_CASE("Test quadrature time", "[Functional]"){
+    const int n=10000000;
+    const double pi=3.14159265358979323846;
+    auto fn=[](const auto& x){
+        return x*x*(1.0-x);
+    };
+    const double h=1.0/n;
+    auto started = std::chrono::high_resolution_clock::now();
+    auto byHand=futilities::sum(0, n+1, [&](const auto& i){
+        return (i==0||i==n?1.0:i%2==1?4.0:2.0)*fn(i*h);
+    })*h/3.0;
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed simpson with sum: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto result=futilities::quadrature::simpson(0.0, 1.0, n, fn);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities quadrature simpson: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(result==Approx(byHand).epsilon(1e-12));
+    REQUIRE(result==Approx(1.0/12.0).epsilon(1e-12));
+    std::vector<double> frequencies(10000);
+    for(int i=0; i<10000; ++i){
+        frequencies[i]=i*.01;
+    }
+    auto rule=futilities::quadrature::gauss_legendre_rule(0.0, pi, 32, 8);
+    started = std::chrono::high_resolution_clock::now();
+    auto loop=futilities::for_each_copy(frequencies, [&](const auto& w, const auto& index, const auto& array){
+        return futilities::sum(0, rule.size(), [&](const auto& i){
+            return rule.weights[i]*std::exp(-w*rule.nodes[i]*rule.nodes[i]);
+        });
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed gauss_legendre with sum in for_each: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto batch=futilities::quadrature::integrate_batch(rule, frequencies, [](const auto& x, const auto& w){
+        return std::exp(-w*x*x);
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities quadrature integrate_batch: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    for(int i=0; i<10000; i+=97){
+        REQUIRE(batch[i]==Approx(loop[i]));
+    }
+}
+TEST_CASE("Test quadrature adaptive smooth", "[Functional]"){
+    auto result=futilities::quadrature::adaptive(0.0, 1.0, [](const auto& x){
+        return std::exp(x);
+    });
+    REQUIRE(result.value==Approx(std::exp(1.0)-1.0).epsilon(1e-14));
+    REQUIRE(result.evaluations==15);
+    REQUIRE(result.error<1e-10);
+    //the seven point gauss rule is exact for degree 13, so the error estimate is tiny
+    auto polynomial=futilities::quadrature::adaptive(-1.0, 2.0, [](const auto& x){
+        return futilities::int_power(x, 13);
+    });
+    REQUIRE(polynomial.value==Approx((std::pow(2.0, 14)-1.0)/14.0).epsilon(1e-14));
+}
+TEST_CASE("Test quadrature adaptive kinks and singularities", "[Functional]"){
+    auto kink=futilities::quadrature::adaptive(0.0, 1.0, [](const auto& x){
+        return std::abs(x-1.0/3.0);
+    }, 1e-12, 1e-12);
+    REQUIRE(std::abs(kink.value-5.0/18.0)<1e-12);
+    REQUIRE(std::abs(kink.value-5.0/18.0)<=kink.error);
+    REQUIRE(kink.evaluations<5000);
+    auto singular=futilities::quadrature::adaptive(0.0, 1.0, [](const auto& x){
+        return 1.0/std::sqrt(x);
+    }, 1e-9, 1e-9);
+    REQUIRE(std::abs(singular.value-2.0)<1e-8);
+    REQUIRE(singular.evaluations<5000);
+    auto peak=futilities::quadrature::adaptive(-1.0, 1.0, [](const auto& x){
+        return 1.0/(1e-6+x*x);
+    }, 1e-8, 1e-10);
+    REQUIRE(peak.value==Approx(2.0*std::atan(1000.0)/1e-3).epsilon(1e-9));
+}
+TEST_CASE("Test quadrature adaptive limits", "[Functional]"){
+    auto limited=futilities::quadrature::adaptive(0.0, 1.0, [](const auto& x){
+        return std::sin(1.0/(x+1e-3));
+    }, 1e-15, 0.0, 1000);
+    REQUIRE(limited.evaluations<=1000);
+    REQUIRE(limited.error>1e-15);
+    auto empty=futilities::quadrature::adaptive(1.0, 1.0, [](const auto& x){
+        return x;
+    });
+    REQUIRE(empty.value==0.0);
+    auto reversed=futilities::quadrature::adaptive(1.0, 0.0, [](const auto& x){
+        return x;
+    });
+    REQUIRE(reversed.value==Approx(-.5));
+}
+#ifdef _OPENMP
+TEST_CASE("Test quadrature adaptive limits with many threads", "[Functional]"){
+    const int threads=omp_get_max_threads();
+    omp_set_num_threads(16);
+    for(int maxEvaluations:{100, 1000, 1003}){
+        std::atomic<int> calls(0);
+        auto limited=futilities::quadrature::adaptive(0.0, 1.0, [&](const auto& x){
+            ++calls;
+            //hand the core to the other threads mid segment
+            std::this_thread::yield();
+            return std::sin(1.0/(x+1e-3));
+        }, 1e-15, 0.0, maxEvaluations);
+        REQUIRE(limited.evaluations<=maxEvaluations);
+        REQUIRE(calls==limited.evaluations);
+    }
+    omp_set_num_threads(threads);
+}
+#endif
+TEST_CASE("Test quadrature adaptive time", "[Functional]"){
+    auto fn=[](const auto& x){
+        return std::sqrt(std::abs(x-.3))*std::exp(-x);
+    };
+    auto started = std::chrono::high_resolution_clock::now();
+    auto fixed=futilities::quadrature::simpson(0.0, 2.0, 10000000, fn);
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities quadrature simpson n=1e7: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto adaptive=futilities::quadrature::adaptive(0.0, 2.0, fn, 1e-12, 1e-12);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities quadrature adaptive with "<<adaptive.evaluations<<" evaluations: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    auto reference=futilities::quadrature::adaptive(0.0, .3, fn, 1e-14, 1e-14).value+
+        futilities::quadrature::adaptive(.3, 2.0, fn, 1e-14, 1e-14).value;
+    REQUIRE(std::abs(adaptive.value-reference)<1e-11);
+    REQUIRE(std::abs(fixed-reference)>std::abs(adaptive.value-reference));
+}
+TEST_CASE("Test philox known answers", "[Functional]"){
+    typedef std::array<std::uint32_t, 4> words;
+    REQUIRE((futilities::random::philox4x32({0, 0, 0, 0}, {0, 0})==words({0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8})));
+    REQUIRE((futilities::random::philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff})==words({0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd})));
+    REQUIRE((futilities::random::philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0})==words({0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1})));
+}
+TEST_CASE("Test counter_rng is reproducible", "[Functional]"){
+    futilities::random::counter_rng rng(42);
+    REQUIRE(rng.uniform(7, 3)==rng.uniform(7, 3));
+    REQUIRE(rng.uniform(7, 3)!=rng.uniform(8, 3));
+    REQUIRE(rng.uniform(7, 3)!=rng.uniform(7, 4));
+    REQUIRE(rng.uniform(7, 3)!=futilities::random::counter_rng(43).uniform(7, 3));
+    REQUIRE(rng.uniform(7, 3)!=futilities::random::counter_rng(42, 1).uniform(7, 3));
+    const int n=10001;
+    auto uniforms=rng.fill_uniform(std::vector<double>(n), 5);
+    auto floats=rng.fill_uniform(std::vector<float>(n), 5);
+    auto normals=rng.fill_normal(std::vector<double>(n), 5);
+    auto floatNormals=rng.fill_normal(std::vector<float>(n), 5);
+    for(int k=0; k<n; ++k){
+        REQUIRE(uniforms[k]==rng.uniform(5, k));
+        REQUIRE(floats[k]==rng.uniform<float>(5, k));
+        REQUIRE(normals[k]==rng.normal(5, k));
+        REQUIRE(floatNormals[k]==rng.normal<float>(5, k));
+    }
+    //an offset fill continues the stream, including from odd draws
+    auto offset=rng.fill_normal(std::vector<double>(2049), 5, 7);
+    auto offsetUniforms=rng.fill_uniform(std::vector<float>(2049), 5, 7);
+    for(int k=0; k<2049; ++k){
+        REQUIRE(offset[k]==rng.normal(5, k+7));
+        REQUIRE(offsetUniforms[k]==rng.uniform<float>(5, k+7));
+    }
+    //the same numbers whatever the order of evaluation
+    auto byIndex=futilities::for_each_parallel(0, 1000, [&](const auto& i){
+        return rng.normal(i, 2);
+    });
+    for(int i=999; i>=0; --i){
+        REQUIRE(byIndex[i]==rng.normal(i, 2));
+    }
+    //draws of neighbouring indices side by side, from odd draws and past 2^32
+    const int numIndices=1030;
+    const int numDraws=5;
+    const std::uint64_t firstIndex=(std::uint64_t(1)<<32)-3;
+    std::vector<double> side(numDraws*numIndices);
+    std::vector<float> floatSide(numDraws*numIndices);
+    rng.fill_normal_indices(side.data(), numIndices, firstIndex, numIndices, 3, numDraws);
+    rng.fill_normal_indices(floatSide.data(), numIndices, firstIndex, numIndices, 3, numDraws);
+    for(int k=0; k<numDraws; ++k){
+        for(int i=0; i<numIndices; ++i){
+            REQUIRE(side[k*numIndices+i]==rng.normal(firstIndex+i, 3+k));
+            REQUIRE(floatSide[k*numIndices+i]==rng.normal<float>(firstIndex+i, 3+k));
+        }
+    }
+}
+TEST_CASE("Test counter_rng distributions", "[Functional]"){
+    futilities::random::counter_rng rng(2017);
+    const int n=1000000;
+    auto uniforms=rng.fill_uniform(std::vector<double>(n));
+    double minimum=1.0;
+    double maximum=0.0;
+    for(const auto& u:uniforms){
+        minimum=std::min(minimum, u);
+        maximum=std::max(maximum, u);
+    }
+    REQUIRE(minimum>0.0);
+    REQUIRE(maximum<1.0);
+    const double mean=futilities::sum(uniforms, [](const auto& u, const auto& i){
+        return u;
+    })/n;
+    REQUIRE(std::abs(mean-.5)<4.0*std::sqrt(1.0/12.0/n));
+    auto normals=rng.fill_normal(std::vector<double>(n), 1);
+    const double normalMean=futilities::sum(normals, [](const auto& z, const auto& i){
+        return z;
+    })/n;
+    const double variance=futilities::sum(normals, [](const auto& z, const auto& i){
+        return z*z;
+    })/n;
+    const double fourth=futilities::sum(normals, [](const auto& z, const auto& i){
+        return z*z*z*z;
+    })/n;
+    REQUIRE(std::abs(normalMean)<4.0/std::sqrt(n));
+    REQUIRE(std::abs(variance-1.0)<4.0*std::sqrt(2.0/n));
+    REQUIRE(std::abs(fourth-3.0)<4.0*std::sqrt(96.0/n));
+    //successive draws of one index are uncorrelated
+    const double lagged=futilities::sum(0, n-1, [&](const auto& k){
+        return normals[k]*normals[k+1];
+    })/n;
+    REQUIRE(std::abs(lagged)<4.0/std::sqrt(n));
+    auto floats=rng.fill_uniform(std::vector<float>(n));
+    for(const auto& u:floats){
+        REQUIRE(u>0.0f);
+        REQUIRE(u<1.0f);
+    }
+}
+TEST_CASE("Test counter_rng time", "[Functional]"){
+    const int n=10000000;
+    std::mt19937_64 engine(42);
+    std::normal_distribution<double> distribution;
+    auto started = std::chrono::high_resolution_clock::now();
+    auto mersenne=futilities::for_each(std::vector<double>(n), [&](const auto& val, const auto& index){
+        return distribution(engine);
+    });
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed std::normal_distribution mt19937_64: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    futilities::random::counter_rng rng(42);
+    started = std::chrono::high_resolution_clock::now();
+    auto byIndex=futilities::for_each_parallel(0, n, [&](const auto& i){
+        return rng.normal(i);
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities counter_rng normal in for_each_parallel: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto filled=rng.fill_normal(std::vector<double>(n));
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities counter_rng fill_normal: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto uniforms=rng.fill_uniform(std::vector<double>(n));
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities counter_rng fill_uniform: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(filled.size()==n);
+}
+TEST_CASE("Test monte_carlo statistics", "[Functional]"){
+    std::vector<double> samples(10001);
+    for(int i=0; i<10001; ++i){
+        samples[i]=std::exp(std::sin(i*.37));
+    }
+    futilities::monte_carlo::statistics<double, 4> whole;
+    futilities::monte_carlo::statistics<double, 4> first;
+    futilities::monte_carlo::statistics<double, 4> second;
+    for(int i=0; i<10001; ++i){
+        whole.add(samples[i]);
+        (i<3000?first:second).add(samples[i]);
+    }
+    first.merge(second);
+    const double mean=futilities::sum(samples, [](const auto& x, const auto& i){
+        return x;
+    })/10001.0;
+    auto moment=[&](int k){
+        return futilities::sum(samples, [&](const auto& x, const auto& i){
+            return futilities::int_power(x-mean, k);
+        });
+    };
+    for(const auto& stats:{whole, first}){
+        REQUIRE(stats.count==10001);
+        REQUIRE(stats.mean==Approx(mean).epsilon(1e-13));
+        REQUIRE(stats.m2==Approx(moment(2)).epsilon(1e-12));
+        REQUIRE(stats.m3==Approx(moment(3)).epsilon(1e-10));
+        REQUIRE(stats.m4==Approx(moment(4)).epsilon(1e-12));
+        REQUIRE(stats.variance()==Approx(moment(2)/10000.0).epsilon(1e-12));
+    }
+    futilities::monte_carlo::statistics<double> empty;
+    futilities::monte_carlo::statistics<double> one;
+    one.add(2.0);
+    empty.merge(one);
+    REQUIRE(empty.mean==2.0);
+    REQUIRE(empty.count==1);
+}
+TEST_CASE("Test monte_carlo simulate", "[Functional]"){
+    futilities::random::counter_rng rng(7);
+    auto fn=[&](const auto& path){
+        return rng.normal(path);
+    };
+    auto result=futilities::monte_carlo::simulate<4>(1000000, fn);
+    REQUIRE(result.count==1000000);
+    REQUIRE(std::abs(result.mean)<4.0*result.standard_error());
+    REQUIRE(result.variance()==Approx(1.0).epsilon(.01));
+    REQUIRE(std::abs(result.skewness())<.02);
+    REQUIRE(std::abs(result.excess_kurtosis())<.04);
+    //blocks are merged in order so repeated runs agree exactly
+    auto again=futilities::monte_carlo::simulate<4>(1000000, fn);
+    REQUIRE(again.mean==result.mean);
+    REQUIRE(again.m2==result.m2);
+    auto uniform=futilities::monte_carlo::simulate(100000, [&](const auto& path){
+        return rng.uniform(path);
+    });
+    REQUIRE(uniform.mean==Approx(.5).epsilon(.01));
+    REQUIRE(uniform.variance()==Approx(1.0/12.0).epsilon(.01));
+    //integer samples, eg hit counts, are accumulated in double
+    auto hits=futilities::monte_carlo::simulate(100000, [&](const auto& path){
+        return rng.uniform(path)<.25?1:0;
+    });
+    static_assert(std::is_same<decltype(hits.mean), double>::value, "hit counts accumulate in double");
+    REQUIRE(hits.mean==Approx(.25).epsilon(.02));
+    REQUIRE(hits.variance()==Approx(.25*.75).epsilon(.02));
+}
+#ifdef _OPENMP
+TEST_CASE("Test monte_carlo same result for any thread count", "[Functional]"){
+    futilities::random::counter_rng rng(19);
+    auto fn=[&](const auto& path){
+        return std::exp(rng.normal(path));
+    };
+    const int threads=omp_get_max_threads();
+    omp_set_num_threads(1);
+    auto serial=futilities::monte_carlo::simulate<4>(300001, fn);
+    auto serialUntil=futilities::monte_carlo::simulate_until(.005, 1000000, fn, 20000);
+    for(int numThreads:{2, 3, 16}){
+        omp_set_num_threads(numThreads);
+        auto parallel=futilities::monte_carlo::simulate<4>(300001, fn);
+        REQUIRE(parallel.count==serial.count);
+        REQUIRE(parallel.mean==serial.mean);
+        REQUIRE(parallel.m2==serial.m2);
+        REQUIRE(parallel.m3==serial.m3);
+        REQUIRE(parallel.m4==serial.m4);
+        auto parallelUntil=futilities::monte_carlo::simulate_until(.005, 1000000, fn, 20000);
+        REQUIRE(parallelUntil.count==serialUntil.count);
+        REQUIRE(parallelUntil.mean==serialUntil.mean);
+        REQUIRE(parallelUntil.m2==serialUntil.m2);
+    }
+    omp_set_num_threads(threads);
+}
+#endif
+TEST_CASE("Test monte_carlo simulate_until", "[Functional]"){
+    futilities::random::counter_rng rng(11);
+    auto fn=[&](const auto& path){
+        return 3.0*rng.normal(path);
+    };
+    auto result=futilities::monte_carlo::simulate_until(.01, 100000000, fn, 10000);
+    REQUIRE(result.standard_error()<=.01);
+    REQUIRE(result.count%10000==0);
+    //three standard deviations need about 90000 paths
+    REQUIRE(result.count<200000);
+    auto capped=futilities::monte_carlo::simulate_until(1e-6, 50000, fn, 30000);
+    REQUIRE(capped.count==50000);
+    REQUIRE(capped.standard_error()>1e-6);
+}
+TEST_CASE("Test monte_carlo time", "[Functional]"){
+    const int n=10000000;
+    const double s0=100.0, strike=105.0, r=.03, sigma=.2, t=1.0;
+    const double drift=(r-.5*sigma*sigma)*t;
+    const double volatility=sigma*std::sqrt(t);
+    const double discount=std::exp(-r*t);
+    futilities::random::counter_rng rng(2017);
+    auto payoff=[&](const auto& path){
+        return discount*std::max(s0*std::exp(drift+volatility*rng.normal(path))-strike, 0.0);
+    };
+    auto started = std::chrono::high_resolution_clock::now();
+    auto payoffs=futilities::for_each_parallel(0, n, payoff);
+    const double stored=futilities::sum(payoffs, [](const auto& x, const auto& i){
+        return x;
+    })/n;
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed payoff vector and sum: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto result=futilities::monte_carlo::simulate(n, payoff);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities monte_carlo simulate: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(result.mean==Approx(stored).epsilon(1e-12));
+    //black scholes
+    auto normalCdf=[](double x){
+        return .5*std::erfc(-x/std::sqrt(2.0));
+    };
+    const double d1=(std::log(s0/strike)+(r+.5*sigma*sigma)*t)/volatility;
+    const double exact=s0*normalCdf(d1)-strike*discount*normalCdf(d1-volatility);
+    REQUIRE(std::abs(result.mean-exact)<4.0*result.standard_error());
+}
+TEST_CASE("Test sde euler", "[Functional]"){
+    futilities::random::counter_rng rng(11);
+    const double x0=100.0;
+    const double r=.05;
+    const double sigma=.3;
+    const double t=1.0;
+    const int numPaths=100001;
+    auto terminal=futilities::sde::euler(x0, t, 50, numPaths, [&](const auto& x, const auto& time){
+        return r*x;
+    }, [&](const auto& x, const auto& time){
+        return sigma*x;
+    }, rng);
+    REQUIRE(terminal.size()==numPaths);
+    futilities::monte_carlo::statistics<double> stats;
+    for(const auto& x:terminal){
+        stats.add(x);
+    }
+    //Euler preserves the mean of a linear SDE: x0*(1+r*dt)^n
+    const double expected=x0*futilities::int_power(1.0+r/50.0, 50);
+    REQUIRE(std::abs(stats.mean-expected)<4.0*stats.standard_error());
+    //increments are rng.normal(path, step) whatever the blocking
+    auto oneStep=futilities::sde::euler(x0, t, 1, 1000, [&](const auto& x, const auto& time){
+        return r*x;
+    }, [&](const auto& x, const auto& time){
+        return sigma*x;
+    }, rng);
+    for(int p=0; p<1000; ++p){
+        REQUIRE(oneStep[p]==Approx(x0+r*x0+sigma*x0*rng.normal(p, 0)));
+    }
+}
+TEST_CASE("Test sde milstein strong error", "[Functional]"){
+    futilities::random::counter_rng rng(5);
+    const double x0=1.0;
+    const double mu=.1;
+    const double sigma=.8;
+    const double t=1.0;
+    const int numSteps=32;
+    const int numPaths=2000;
+    auto drift=[&](const auto& x, const auto& time){
+        return mu*x;
+    };
+    auto diffusion=[&](const auto& x, const auto& time){
+        return sigma*x;
+    };
+    auto euler=futilities::sde::euler(x0, t, numSteps, numPaths, drift, diffusion, rng);
+    auto milstein=futilities::sde::milstein(x0, t, numSteps, numPaths, drift, diffusion, [&](const auto& x, const auto& time){
+        return sigma+0.0*x;
+    }, rng);
+    const double sqrtDt=std::sqrt(t/numSteps);
+    double eulerError=0.0;
+    double milsteinError=0.0;
+    for(int p=0; p<numPaths; ++p){
+        const double w=sqrtDt*futilities::sum(0, numSteps, [&](const auto& s){
+            return rng.normal(p, s);
+        });
+        const double exact=x0*std::exp((mu-.5*sigma*sigma)*t+sigma*w);
+        eulerError+=std::abs(euler[p]-exact);
+        milsteinError+=std::abs(milstein[p]-exact);
+    }
+    REQUIRE(milsteinError<.5*eulerError);
+}
+TEST_CASE("Test sde running statistic", "[Functional]"){
+    futilities::random::counter_rng rng(3);
+    const double dt=.01;
+    const int numSteps=100;
+    const int numPaths=1500;
+    auto drift=[](const auto& x, const auto& time){
+        return 1.0-x;
+    };
+    auto diffusion=[](const auto& x, const auto& time){
+        return .5+0.0*x;
+    };
+    auto result=futilities::sde::euler(0.0, 1.0, numSteps, numPaths, drift, diffusion, rng, [](const auto& running, const auto& x, int step){
+        return running>x?running:x;
+    });
+    auto averaged=futilities::sde::euler(0.0, 1.0, numSteps, numPaths, drift, diffusion, rng, [&](const auto& running, const auto& x, int step){
+        return running+(x-running)/(double)step;
+    });
+    for(int p=0; p<numPaths; p+=7){
+        double maximum=0.0;
+        double total=0.0;
+        const double terminal=futilities::recurse(numSteps, 0.0, [&](const auto& x, const auto& s){
+            const double next=x+(1.0-x)*dt+.5*std::sqrt(dt)*rng.normal(p, s);
+            maximum=std::max(maximum, next);
+            total+=next;
+            return next;
+        });
+        REQUIRE(result.first[p]==Approx(terminal));
+        REQUIRE(result.second[p]==Approx(maximum));
+        REQUIRE(averaged.second[p]==Approx(total/numSteps));
+    }
+}
+TEST_CASE("Test sde time", "[Functional]"){
+    futilities::random::counter_rng rng(42);
+    const int numSteps=100;
+    const int numPaths=100000;
+    const double dt=1.0/numSteps;
+    auto started = std::chrono::high_resolution_clock::now();
+    auto byPath=futilities::for_each_parallel(0, numPaths, [&](const auto& p){
+        return futilities::recurse(numSteps, 1.0, [&](const auto& x, const auto& s){
+            return x+.05*x*dt+.2*x*std::sqrt(dt)*rng.normal(p, s);
+        });
+    });
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities recurse per path: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto batched=futilities::sde::euler(1.0, 1.0, numSteps, numPaths, [](const auto& x, const auto& time){
+        return .05*x;
+    }, [](const auto& x, const auto& time){
+        return .2*x;
+    }, rng);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities sde euler: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(batched[17]==Approx(byPath[17]));
+}
+TEST_CASE("Test ode rk4", "[Functional]"){
+    auto oscillator=[](const auto& y, const auto& t, auto& dydt){
+        dydt[0]=y[1];
+        dydt[1]=-y[0];
+    };
+    auto coarse=futilities::ode::rk4(std::vector<double>({1.0, 0.0}), 0.0, 2.0, 20, oscillator);
+    auto fine=futilities::ode::rk4(std::vector<double>({1.0, 0.0}), 0.0, 2.0, 40, oscillator);
+    const double coarseError=std::abs(coarse[0]-std::cos(2.0));
+    const double fineError=std::abs(fine[0]-std::cos(2.0));
+    REQUIRE(fineError<1e-6);
+    //fourth order: halving the step divides the error by about 16
+    REQUIRE(coarseError/fineError>12.0);
+    REQUIRE(coarseError/fineError<20.0);
+    REQUIRE(fine[1]==Approx(-std::sin(2.0)).epsilon(1e-6));
+}
+TEST_CASE("Test ode dormand_prince", "[Functional]"){
+    auto gaussian=futilities::ode::dormand_prince(std::vector<double>({1.0}), 0.0, 3.0, [](const auto& y, const auto& t, auto& dydt){
+        dydt[0]=-2.0*t*y[0];
+    }, 1e-12, 1e-12);
+    REQUIRE(gaussian.time==3.0);
+    REQUIRE(gaussian.state[0]==Approx(std::exp(-9.0)).epsilon(1e-9));
+    //tighter tolerances take more steps
+    auto loose=futilities::ode::dormand_prince(std::vector<double>({1.0, 0.0}), 0.0, 10.0, [](const auto& y, const auto& t, auto& dydt){
+        dydt[0]=y[1];
+        dydt[1]=-y[0];
+    }, 1e-6, 1e-6);
+    auto tight=futilities::ode::dormand_prince(std::vector<double>({1.0, 0.0}), 0.0, 10.0, [](const auto& y, const auto& t, auto& dydt){
+        dydt[0]=y[1];
+        dydt[1]=-y[0];
+    }, 1e-11, 1e-11);
+    REQUIRE(std::abs(loose.state[0]-std::cos(10.0))<1e-4);
+    REQUIRE(std::abs(tight.state[0]-std::cos(10.0))<1e-9);
+    REQUIRE(tight.accepted>loose.accepted);
+    auto limited=futilities::ode::dormand_prince(std::vector<double>({1.0, 0.0}), 0.0, 10.0, [](const auto& y, const auto& t, auto& dydt){
+        dydt[0]=y[1];
+        dydt[1]=-y[0];
+    }, 1e-11, 1e-11, 10);
+    REQUIRE(limited.accepted+limited.rejected==10);
+    REQUIRE(limited.time<10.0);
+}
+TEST_CASE("Test ode batches", "[Functional]"){
+    const int numSystems=1003;
+    std::vector<double> states(2*numSystems);
+    std::vector<double> frequencies(numSystems);
+    for(int i=0; i<numSystems; ++i){
+        states[i]=1.0;
+        states[numSystems+i]=0.0;
+        frequencies[i]=.5+i*.003;
+    }
+    auto system=[](const auto& y, const auto& t, const auto& w){
+        return std::decay_t<decltype(y)>{{y[1], -w*w*y[0]}};
+    };
+    auto fixed=futilities::ode::rk4_batch<2>(std::vector<double>(states), frequencies, 0.0, 1.5, 60, system);
+    auto adaptive=futilities::ode::dormand_prince_batch<2>(std::vector<double>(states), frequencies, 0.0, 1.5, system, 1e-11, 1e-11);
+    for(int i=0; i<numSystems; ++i){
+        const double w=frequencies[i];
+        auto single=futilities::ode::rk4(std::vector<double>({1.0, 0.0}), 0.0, 1.5, 60, [&](const auto& y, const auto& t, auto& dydt){
+            dydt[0]=y[1];
+            dydt[1]=-w*w*y[0];
+        });
+        REQUIRE(fixed[i]==Approx(single[0]).epsilon(1e-12));
+        REQUIRE(fixed[numSystems+i]==Approx(single[1]).epsilon(1e-12));
+        REQUIRE(std::abs(adaptive[i]-std::cos(w*1.5))<1e-9);
+        REQUIRE(std::abs(adaptive[numSystems+i]+w*std::sin(w*1.5))<1e-9);
+    }
+    auto decay=futilities::ode::dormand_prince_batch<1>(std::vector<double>(5, 2.0), 0.0, 1.0, [](const auto& y, const auto& t){
+        return std::decay_t<decltype(y)>{{-t*y[0]}};
+    });
+    for(const auto& y:decay){
+        REQUIRE(y==Approx(2.0*std::exp(-.5)).epsilon(1e-7));
+    }
+    //trial steps past t=2 take the square root of a negative state and must be rejected cleanly
+    auto draining=futilities::ode::dormand_prince_batch<1>(std::vector<double>(9, 1.0), 0.0, 1.99, [](const auto& y, const auto& t){
+        using std::sqrt;
+        return std::decay_t<decltype(y)>{{-sqrt(y[0])}};
+    }, 1e-6, 1e-6);
+    auto single=futilities::ode::dormand_prince(std::vector<double>({1.0}), 0.0, 1.99, [](const auto& y, const auto& t, auto& dydt){
+        dydt[0]=-std::sqrt(y[0]);
+    }, 1e-6, 1e-6);
+    REQUIRE(single.rejected>0);
+    for(const auto& y:draining){
+        REQUIRE(y==Approx(single.state[0]).epsilon(1e-6));
+        REQUIRE(std::abs(y-.005*.005)<1e-6);
+    }
+}
+TEST_CASE("Test ode time", "[Functional]"){
+    const int numSystems=20000;
+    const int numSteps=100;
+    std::vector<double> frequencies(numSystems);
+    std::vector<double> states(2*numSystems, 0.0);
+    for(int i=0; i<numSystems; ++i){
+        frequencies[i]=1.0+i*1e-4;
+        states[i]=1.0;
+    }
+    const double h=1.0/numSteps;
+    auto started = std::chrono::high_resolution_clock::now();
+    auto bySystem=futilities::for_each_parallel(0, numSystems, [&](const auto& i){
+        const double w=frequencies[i];
+        auto derivative=[&](const std::vector<double>& y){
+            return std::vector<double>({y[1], -w*w*y[0]});
+        };
+        return futilities::recurse_move(numSteps, std::vector<double>({1.0, 0.0}), [&](std::vector<double>&& y, const auto& s){
+            auto k1=derivative(y);
+            auto k2=derivative(std::vector<double>({y[0]+.5*h*k1[0], y[1]+.5*h*k1[1]}));
+            auto k3=derivative(std::vector<double>({y[0]+.5*h*k2[0], y[1]+.5*h*k2[1]}));
+            auto k4=derivative(std::vector<double>({y[0]+h*k3[0], y[1]+h*k3[1]}));
+            return std::vector<double>({
+                y[0]+h*(k1[0]+2.0*(k2[0]+k3[0])+k4[0])/6.0,
+                y[1]+h*(k1[1]+2.0*(k2[1]+k3[1])+k4[1])/6.0
+            });
+        })[0];
+    });
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities recurse_move rk4: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto batched=futilities::ode::rk4_batch<2>(std::move(states), frequencies, 0.0, 1.0, numSteps, [](const auto& y, const auto& t, const auto& w){
+        return std::decay_t<decltype(y)>{{y[1], -w*w*y[0]}};
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities ode rk4_batch: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(batched[17]==Approx(bySystem[17]));
+}
+TEST_CASE("Test sobol known points", "[Functional]"){
+    futilities::quasi_random::sobol sequence(64);
+    REQUIRE(sequence.dimensions()==64);
+    //the tables end at 64 dimensions
+    REQUIRE_THROWS_AS(futilities::quasi_random::sobol(65), std::out_of_range);
+    REQUIRE_THROWS_AS(futilities::quasi_random::sobol(65, 42), std::out_of_range);
+    REQUIRE_THROWS_AS(futilities::quasi_random::halton(65), std::out_of_range);
+    REQUIRE_THROWS_AS(futilities::quasi_random::halton(-1, 42), std::out_of_range);
+    REQUIRE(futilities::quasi_random::halton(64).uniform(1, 63)==Approx(1.0/311.0));
+    const std::vector<double> first({0.0, .5, .75, .25, .375, .875, .625, .125});
+    const std::vector<double> second({0.0, .5, .25, .75, .375, .875, .125, .625});
+    for(int i=0; i<8; ++i){
+        REQUIRE(sequence.uniform(i, 0)==first[i]);
+        REQUIRE(sequence.uniform(i, 1)==second[i]);
+    }
+    //values of the Joe and Kuo reference implementation
+    REQUIRE(sequence.uniform(1000, 63)==0.4462890625);
+    REQUIRE(sequence.uniform(4097, 20)==0.1724853515625);
+    REQUIRE(sequence.uniform(123456, 5)==0.20325469970703125);
+    auto filled=sequence.fill_dimension(std::vector<double>(10001), 7, 123);
+    auto floats=sequence.fill_dimension(std::vector<float>(5000), 40);
+    for(int i=0; i<10001; ++i){
+        REQUIRE(filled[i]==sequence.uniform(123+i, 7));
+    }
+    for(int i=0; i<5000; ++i){
+        REQUIRE(floats[i]==sequence.uniform<float>(i, 40));
+        REQUIRE(floats[i]<1.0f);
+    }
+}
+TEST_CASE("Test quasi_random stratification", "[Functional]"){
+    auto isStratified=[](const auto& sequence, int dimension, int count){
+        std::vector<int> bins(count, 0);
+        for(int i=0; i<count; ++i){
+            const double x=sequence.uniform(i, dimension);
+            if(x<0.0||x>=1.0){
+                return false;
+            }
+            ++bins[std::min(count-1, (int)(x*count+1e-9))];
+        }
+        return std::all_of(bins.begin(), bins.end(), [](int b){return b==1;});
+    };
+    futilities::quasi_random::sobol sobol(64);
+    futilities::quasi_random::sobol scrambledSobol(64, 42);
+    for(int d=0; d<64; d+=3){
+        REQUIRE(isStratified(sobol, d, 1024));
+        REQUIRE(isStratified(scrambledSobol, d, 1024));
+    }
+    REQUIRE(scrambledSobol.uniform(0, 0)!=0.0);
+    REQUIRE(scrambledSobol.uniform(5, 3)!=futilities::quasi_random::sobol(64, 43).uniform(5, 3));
+    futilities::quasi_random::halton halton(8);
+    futilities::quasi_random::halton scrambledHalton(8, 42);
+    REQUIRE(halton.uniform(1, 0)==.5);
+    REQUIRE(halton.uniform(3, 0)==.75);
+    REQUIRE(halton.uniform(1, 1)==Approx(1.0/3.0));
+    REQUIRE(halton.uniform(3, 1)==Approx(1.0/9.0));
+    REQUIRE(halton.uniform(7, 2)==Approx(2.0/5.0+1.0/25.0));
+    const std::vector<int> bases({2, 3, 5, 7, 11, 13, 17, 19});
+    for(int d=0; d<8; ++d){
+        const int count=futilities::int_power(bases[d], bases[d]<10?3:2);
+        REQUIRE(isStratified(halton, d, count));
+        REQUIRE(isStratified(scrambledHalton, d, count));
+    }
+    auto filled=scrambledHalton.fill_dimension(std::vector<double>(5000), 4, 77);
+    for(int i=0; i<5000; ++i){
+        REQUIRE(filled[i]==scrambledHalton.uniform(77+i, 4));
+    }
+}
+TEST_CASE("Test quasi_random integration", "[Functional]"){
+    //product of |4x-2|+a over (1+a) integrates to one on the unit cube
+    const int dimensions=8;
+    const int n=1<<14;
+    auto integrate=[&](const auto& sequence){
+        return futilities::sum(0, n, [&](const auto& i){
+            double product=1.0;
+            for(int d=0; d<dimensions; ++d){
+                product*=(std::abs(4.0*sequence.uniform(i, d)-2.0)+d+1.0)/(d+2.0);
+            }
+            return product;
+        })/n;
+    };
+    futilities::random::counter_rng rng(42);
+    const double monteCarloError=std::abs(integrate(rng)-1.0);
+    const double sobolError=std::abs(integrate(futilities::quasi_random::sobol(dimensions))-1.0);
+    const double scrambledError=std::abs(integrate(futilities::quasi_random::sobol(dimensions, 7))-1.0);
+    const double haltonError=std::abs(integrate(futilities::quasi_random::halton(dimensions))-1.0);
+    const double scrambledHaltonError=std::abs(integrate(futilities::quasi_random::halton(dimensions, 7))-1.0);
+    std::cout<<"Integration error monte carlo: "<<monteCarloError<<", sobol: "<<sobolError<<", scrambled sobol: "<<scrambledError<<", halton: "<<haltonError<<", scrambled halton: "<<scrambledHaltonError<<std::endl;
+    REQUIRE(sobolError<2e-4);
+    REQUIRE(scrambledError<2e-4);
+    REQUIRE(haltonError<1e-3);
+    REQUIRE(scrambledHaltonError<1e-3);
+    //the points can be drawn in any order
+    futilities::quasi_random::sobol sequence(dimensions, 7);
+    auto byIndex=futilities::for_each_parallel(0, 1000, [&](const auto& i){
+        return sequence.uniform(i, 3);
+    });
+    for(int i=999; i>=0; --i){
+        REQUIRE(byIndex[i]==sequence.uniform(i, 3));
+    }
+}
+TEST_CASE("Test quasi_random time", "[Functional]"){
+    const int n=10000000;
+    futilities::random::counter_rng rng(42);
+    futilities::quasi_random::sobol sobol(16);
+    futilities::quasi_random::sobol scrambled(16, 42);
+    futilities::quasi_random::halton halton(16);
+    auto started = std::chrono::high_resolution_clock::now();
+    auto uniforms=rng.fill_uniform(std::vector<double>(n));
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities counter_rng fill_uniform: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto byIndex=futilities::for_each_parallel(0, n, [&](const auto& i){
+        return sobol.uniform(i, 9);
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities sobol uniform in for_each_parallel: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto filled=sobol.fill_dimension(std::vector<double>(n), 9);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities sobol fill_dimension: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto scrambledFilled=scrambled.fill_dimension(std::vector<double>(n), 9);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities scrambled sobol fill_dimension: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto haltonFilled=halton.fill_dimension(std::vector<double>(n), 9);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities halton fill_dimension: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(filled[n-1]==byIndex[n-1]);
+}
+TEST_CASE("Test discrete tables", "[Functional]"){
+    const int n=1000;
+    std::vector<double> weights(n);
+    for(int i=0; i<n; ++i){
+        weights[i]=i%7==3?0.0:1.0+.9*std::sin(i*1.3)+(i%50==0?30.0:0.0);
+    }
+    futilities::discrete::alias_table<> alias(weights);
+    futilities::discrete::cdf_table<> cdf(weights);
+    REQUIRE(alias.size()==n);
+    REQUIRE(cdf.size()==n);
+    auto cumulative=futilities::cumulative_sum_copy(weights, [](const auto& w, const auto& i){
+        return w;
+    });
+    const double total=cumulative.back();
+    //evenly spaced uniforms give the probabilities up to the spacing
+    const int m=1000000;
+    auto uniforms=futilities::for_each_parallel(0, m, [&](const auto& k){
+        return (k+.5)/m;
+    });
+    auto fromAlias=alias.sample(uniforms);
+    auto fromCdf=cdf.sample(uniforms);
+    std::vector<double> aliasCounts(n, 0.0);
+    std::vector<double> cdfCounts(n, 0.0);
+    int mismatches=0;
+    for(int k=0; k<m; ++k){
+        mismatches+=fromCdf[k]!=std::upper_bound(cumulative.begin(), cumulative.end(), uniforms[k]*total)-cumulative.begin();
+        mismatches+=fromCdf[k]!=cdf.sample(uniforms[k]);
+        mismatches+=fromAlias[k]!=alias.sample(uniforms[k]);
+        aliasCounts[fromAlias[k]]+=1.0;
+        cdfCounts[fromCdf[k]]+=1.0;
+    }
+    REQUIRE(mismatches==0);
+    for(int i=0; i<n; ++i){
+        REQUIRE(std::abs(aliasCounts[i]/m-weights[i]/total)<1e-5);
+        REQUIRE(std::abs(cdfCounts[i]/m-weights[i]/total)<2e-6);
+        if(weights[i]==0.0){
+            REQUIRE(aliasCounts[i]==0.0);
+            REQUIRE(cdfCounts[i]==0.0);
+        }
+    }
+    //uniform weights of every size up to a few levels of the search tree
+    for(int size=1; size<40; ++size){
+        futilities::discrete::alias_table<> uniformAlias(std::vector<double>(size, 2.0));
+        futilities::discrete::cdf_table<> uniformCdf(std::vector<double>(size, 2.0));
+        for(int k=0; k<10*size; ++k){
+            const double u=(k+.5)/(10*size);
+            REQUIRE(uniformAlias.sample(u)==k/10);
+            REQUIRE(uniformCdf.sample(u)==k/10);
+        }
+    }
+}
+TEST_CASE("Test discrete tables random draws", "[Functional]"){
+    std::vector<float> weights({1.0f, 0.0f, 3.0f, 6.0f});
+    futilities::random::counter_rng rng(9);
+    auto uniforms=rng.fill_uniform(std::vector<float>(400000));
+    auto fromAlias=futilities::discrete::alias_table<float>(weights).sample(uniforms);
+    auto fromCdf=futilities::discrete::cdf_table<float>(weights).sample(uniforms);
+    for(const auto& draws:{fromAlias, fromCdf}){
+        std::vector<double> counts(4, 0.0);
+        for(const auto& i:draws){
+            counts[i]+=1.0;
+        }
+        for(int i=0; i<4; ++i){
+            const double p=weights[i]/10.0;
+            REQUIRE(std::abs(counts[i]/400000.0-p)<=4.0*std::sqrt(p*(1.0-p)/400000.0));
+        }
+    }
+}
+TEST_CASE("Test discrete tables time", "[Functional]"){
+    const int n=1<<23;
+    const int m=4000000;
+    futilities::random::counter_rng rng(42);
+    auto weights=rng.fill_uniform(std::vector<double>(n), 1);
+    auto uniforms=rng.fill_uniform(std::vector<double>(m), 2);
+    auto started = std::chrono::high_resolution_clock::now();
+    auto cumulative=futilities::cumulative_sum_copy(weights, [](const auto& w, const auto& i){
+        return w;
+    });
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities cumulative_sum_copy 8M: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    futilities::discrete::alias_table<> alias(weights);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities alias_table build 8M: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    futilities::discrete::cdf_table<> cdf(weights);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities cdf_table build 8M: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    const double total=cumulative.back();
+    started = std::chrono::high_resolution_clock::now();
+    auto bySearch=futilities::for_each_parallel(0, m, [&](const auto& k){
+        return (int)(std::upper_bound(cumulative.begin(), cumulative.end(), uniforms[k]*total)-cumulative.begin());
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed std::upper_bound 4M draws: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto fromCdf=cdf.sample(uniforms);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities cdf_table 4M draws: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    started = std::chrono::high_resolution_clock::now();
+    auto fromAlias=alias.sample(uniforms);
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities alias_table 4M draws: "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+    REQUIRE(fromCdf[17]==bySearch[17]);
+}
+TEST_CASE("Test search indices", "[Functional]"){
+    auto matches=[](const auto& index, const auto& sorted, const auto& queries){
+        auto lower=index.lower_bound_batch(queries);
+        auto upper=index.upper_bound_batch(queries);
+        int mismatches=0;
+        for(int i=0; i<(int)queries.size(); ++i){
+            const int expectedLower=std::lower_bound(sorted.begin(), sorted.end(), queries[i])-sorted.begin();
+            const int expectedUpper=std::upper_bound(sorted.begin(), sorted.end(), queries[i])-sorted.begin();
+            mismatches+=index.lower_bound(queries[i])!=expectedLower;
+            mismatches+=index.upper_bound(queries[i])!=expectedUpper;
+            mismatches+=lower[i]!=expectedLower;
+            mismatches+=upper[i]!=expectedUpper;
+        }
+        return mismatches;
+    };
+    //sizes around the levels of both trees, with repeated values
+    for(int n=0; n<700; n+=n<300?1:37){
+        std::vector<double> sorted(n);
+        for(int i=0; i<n; ++i){
+            sorted[i]=i*7/3;
+        }
+        std::vector<double> queries({-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()});
+        for(double x=-2.0; x<=n*7/3+2; x+=.5){
+            queries.push_back(x);
+        }
+        REQUIRE(futilities::search::eytzinger<>(sorted).size()==n);
+        REQUIRE(futilities::search::s_tree<>(sorted).size()==n);
+        REQUIRE(matches(futilities::search::eytzinger<>(sorted), sorted, queries)==0);
+        REQUIRE(matches(futilities::search::s_tree<>(sorted), sorted, queries)==0);
+        REQUIRE(matches(futilities::search::s_tree<double, 16>(sorted), sorted, queries)==0);
+        std::vector<int> integers(sorted.begin(), sorted.end());
+        std::vector<int> integerQueries({std::numeric_limits<int>::lowest(), std::numeric_limits<int>::max()});
+        for(int x=-2; x<=n*7/3+2; ++x){
+            integerQueries.push_back(x);
+        }
+        REQUIRE(matches(futilities::search::eytzinger<int>(integers), integers, integerQueries)==0);
+        REQUIRE(matches(futilities::search::s_tree<int>(integers), integers, integerQueries)==0);
+    }
+    //infinite keys, which leave no value below or above them to use as a sentinel
+    const double inf=std::numeric_limits<double>::infinity();
+    for(int n=1; n<40; ++n){
+        std::vector<double> sorted(n);
+        for(int i=0; i<n; ++i){
+            sorted[i]=i<n/3?-inf:(i>=n-n/3?inf:i);
+        }
+        std::vector<double> queries({-inf, inf, -1.0, n/2.0, (double)n});
+        REQUIRE(matches(futilities::search::eytzinger<>(sorted), sorted, queries)==0);
+        REQUIRE(matches(futilities::search::s_tree<>(sorted), sorted, queries)==0);
+    }
+    //the output of cumulative_sum
+    futilities::random::counter_rng rng(3);
+    auto cumulative=futilities::cumulative_sum(rng.fill_uniform(std::vector<double>(100000)), [](const auto& x, const auto& i){
+        return x;
+    });
+    auto queries=futilities::for_each(rng.fill_uniform(std::vector<double>(100000), 1), [&](const auto& u, const auto& i){
+        return u*cumulative.back();
+    });
+    REQUIRE(matches(futilities::search::eytzinger<>(cumulative), cumulative, queries)==0);
+    REQUIRE(matches(futilities::search::s_tree<>(cumulative), cumulative, queries)==0);
+}
+TEST_CASE("Test search indices time", "[Functional]"){
+    const int m=2000000;
+    futilities::random::counter_rng rng(42);
+    //about the size of L1, L2, L3 and main memory
+    for(const int n:{4096, 65536, 1<<20, 1<<24}){
+        auto sorted=futilities::cumulative_sum(rng.fill_uniform(std::vector<double>(n)), [](const auto& x, const auto& i){
+            return x;
+        });
+        auto queries=futilities::for_each(rng.fill_uniform(std::vector<double>(m), 1), [&](const auto& u, const auto& i){
+            return u*sorted.back();
+        });
+        auto started = std::chrono::high_resolution_clock::now();
+        auto bySearch=futilities::for_each_parallel(0, m, [&](const auto& i){
+            return (int)(std::lower_bound(sorted.begin(), sorted.end(), queries[i])-sorted.begin());
+        });
+        auto done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed std::lower_bound n="<<n<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+        futilities::search::eytzinger<> eytzinger(sorted);
+        started = std::chrono::high_resolution_clock::now();
+        auto fromEytzinger=eytzinger.lower_bound_batch(queries);
+        done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed futilities eytzinger lower_bound_batch n="<<n<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+        futilities::search::s_tree<> tree(sorted);
+        started = std::chrono::high_resolution_clock::now();
+        auto fromTree=tree.lower_bound_batch(queries);
+        done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed futilities s_tree lower_bound_batch n="<<n<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+        REQUIRE(fromEytzinger[17]==bySearch[17]);
+        REQUIRE(fromTree[17]==bySearch[17]);
+    }
+}
 TEST_CASE("Test recurse", "[Functional]"){
     //std::vector<int> testV={5, 6, 7, 8, 9};
     auto valTestV=[](const auto& val, const auto& index){
@@ -132,6 +2077,95 @@ TEST_CASE("Test de-increment", "[Functional]"){
     };
     REQUIRE(futilities::for_each_exclude_last(testV, valTestV)==std::vector<int>({11, 13, 15, 17}));
 }
+TEST_CASE("Test binomial_backward matches for_each_exclude_last", "[Functional]"){
+    int n=5000;
+    int numSteps=4000;
+    auto discountTestV=[](const auto& val, const auto& next, const auto& index, const auto& step){
+        return .49*val+.5*next+.001*index;
+    };
+    std::vector<double> testV=futilities::for_each(0, n, [](const auto& index){
+        return cos(index*.01);
+    });
+    auto expected=futilities::recurse_move(numSteps, std::vector<double>(testV), [&](auto&& arr, const auto& step){
+        return futilities::for_each_exclude_last(std::move(arr), [&](const auto& val, const auto& next, const auto& index){
+            return discountTestV(val, next, index, step);
+        });
+    });
+    auto result=futilities::binomial_backward(std::move(testV), numSteps, discountTestV);
+    REQUIRE(result.size()==expected.size());
+    for(int i=0; i<result.size(); ++i){
+        REQUIRE(result[i]==Approx(expected[i]));
+    }
+}
+TEST_CASE("Test binomial_backward wide lattice", "[Functional]"){
+    int n=100000;
+    int numSteps=3;
+    auto averageTestV=[](const auto& val, const auto& next, const auto& index, const auto& step){
+        return .5*(val+next)+step;
+    };
+    std::vector<double> testV=futilities::for_each(0, n, [](const auto& index){
+        return (double)index;
+    });
+    auto result=futilities::binomial_backward(std::move(testV), numSteps, averageTestV);
+    REQUIRE(result.size()==n-numSteps);
+    for(int i=0; i<result.size(); ++i){
+        REQUIRE(result[i]==Approx(i+1.5+3.0));
+    }
+}
+TEST_CASE("Test binomial_backward american put", "[Functional]"){
+    //Cox Ross Rubinstein tree
+    int n=2000;
+    double S0=50, K=50, r=.1, sigma=.4, T=5.0/12.0;
+    double dt=T/n;
+    double u=exp(sigma*sqrt(dt));
+    double d=1.0/u;
+    double p=(exp(r*dt)-d)/(u-d);
+    double disc=exp(-r*dt);
+    auto assetPrice=[&](const auto& index, const auto& level){
+        return S0*pow(u, 2.0*index-level);
+    };
+    std::vector<double> payoffs=futilities::for_each(0, n+1, [&](const auto& index){
+        return std::max(K-assetPrice(index, n), 0.0);
+    });
+    auto result=futilities::binomial_backward(std::move(payoffs), n, [&](const auto& down, const auto& up, const auto& index, const auto& step){
+        return disc*((1-p)*down+p*up);
+    }, [&](const auto& index, const auto& step){
+        return K-assetPrice(index, n-step-1);
+    });
+    REQUIRE(result.size()==1);
+    REQUIRE(result[0]==Approx(4.28).epsilon(.005));
+}
+TEST_CASE("Test trinomial_backward", "[Functional]"){
+    int n=3001;
+    int numSteps=1500;
+    std::vector<double> testV=futilities::for_each(0, n, [](const auto& index){
+        return sin(index*.01);
+    });
+    auto expected=futilities::recurse_move(numSteps, std::vector<double>(testV), [&](auto&& arr, const auto& step){
+        std::vector<double> next(arr.size()-2);
+        for(int i=0; i<next.size(); ++i){
+            next[i]=std::max(.25*arr[i]+.5*arr[i+1]+.25*arr[i+2], .1*step);
+        }
+        return next;
+    });
+    auto result=futilities::trinomial_backward(std::move(testV), numSteps, [](const auto& down, const auto& mid, const auto& up, const auto& index, const auto& step){
+        return .25*down+.5*mid+.25*up;
+    }, [](const auto& index, const auto& step){
+        return .1*step;
+    });
+    REQUIRE(result.size()==1);
+    REQUIRE(result[0]==Approx(expected[0]));
+}
+TEST_CASE("Test lattice backward on an empty lattice", "[Functional]"){
+    auto binomial=futilities::binomial_backward(std::vector<double>(), 5, [](const auto& down, const auto& up, const auto& index, const auto& step){
+        return down+up;
+    });
+    REQUIRE(binomial.empty());
+    auto trinomial=futilities::trinomial_backward(std::vector<double>(), 5, [](const auto& down, const auto& mid, const auto& up, const auto& index, const auto& step){
+        return down+mid+up;
+    });
+    REQUIRE(trinomial.empty());
+}
 TEST_CASE("Test reduce", "[Functional]"){
     std::vector<int> testV={5, 6, 7, 8, 9};
     auto valTestV=[](const auto& prev, const auto& curr, const auto& index){
@@ -195,6 +2229,360 @@ TEST_CASE("Test reduce_to_single first index", "[Functional]"){
     };
     REQUIRE(futilities::reduce_to_single(testV, valTestV, 10)==10);
 }
+TEST_CASE("Test polynomial", "[Functional]"){
+    std::vector<double> coefficients={1, -2, 3, .5, -1, 2, .25};
+    auto naive=[&](const auto& x){
+        return futilities::reduce_to_single(coefficients, [&](const auto& prev, const auto& curr, const auto& index){
+            return prev+curr*pow(x, index);
+        }, 0.0);
+    };
+    for(double x: {-1.5, 0.0, .3, 2.0}){
+        REQUIRE(futilities::horner(coefficients, x)==Approx(naive(x)));
+        for(int n=1; n<=coefficients.size(); ++n){
+            std::vector<double> subset(coefficients.begin(), coefficients.begin()+n);
+            REQUIRE(futilities::polynomial(subset, x)==Approx(futilities::horner(subset, x)));
+        }
+    }    std::vector<double> none;
+    REQUIRE(futilities::horner(none, 2.0)==0.0);
+    REQUIRE(futilities::polynomial(none, 2.0)==0.0);
+}
+TEST_CASE("Test polynomial fixed size", "[Functional]"){
+    std::array<double, 7> coefficients={1, -2, 3, .5, -1, 2, .25};
+    std::array<double, 1> constant={3};
+    for(double x: {-1.5, 0.0, .3, 2.0}){
+        REQUIRE(futilities::polynomial(coefficients, x)==Approx(futilities::horner(coefficients, x)));
+        REQUIRE(futilities::polynomial(constant, x)==3.0);
+    }
+}
+TEST_CASE("Test polynomial_parallel", "[Functional]"){
+    std::vector<double> coefficients={1, -2, 3, .5, -1, 2, .25};
+    auto xs=futilities::for_each(0, 1000, [](const auto& index){
+        return -1.0+index*.002;
+    });
+    auto result=futilities::polynomial_parallel(coefficients, xs);
+    REQUIRE(result.size()==xs.size());
+    for(int i=0; i<xs.size(); ++i){
+        REQUIRE(result[i]==Approx(futilities::horner(coefficients, xs[i])));
+    }    REQUIRE(futilities::polynomial_parallel(std::vector<double>(), xs)==std::vector<double>(xs.size(), 0.0));
+}
+TEST_CASE("Test polynomial time", "[Functional]"){
+    int n=1000000;
+    std::vector<double> coefficients=futilities::for_each(0, 16, [](const auto& index){
+        return 1.0/(index+1.0);
+    });
+    auto xs=futilities::for_each(0, n, [&](const auto& index){
+        return (double)index/n;
+    });
+    auto started = std::chrono::high_resolution_clock::now();
+    auto result=futilities::polynomial_parallel(coefficients, xs);
+    auto done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities polynomial_parallel: "<<std::chrono::duration_cast<std::chrono::milliseconds>(done-started).count()<<std::endl;
+
+    started = std::chrono::high_resolution_clock::now();
+    auto resultEstrin=futilities::for_each_parallel_copy(xs, [&](const auto& x, const auto& index){
+        return futilities::polynomial(coefficients, x);
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed futilities polynomial: "<<std::chrono::duration_cast<std::chrono::milliseconds>(done-started).count()<<std::endl;
+
+    started = std::chrono::high_resolution_clock::now();
+    auto resultReduce=futilities::for_each_parallel_copy(xs, [&](const auto& x, const auto& index){
+        return futilities::reduce_to_single(coefficients, [&](const auto& prev, const auto& curr, const auto& k){
+            return prev*x+coefficients[coefficients.size()-1-k];
+        }, 0.0);
+    });
+    done = std::chrono::high_resolution_clock::now();
+    std::cout << "Speed reduce_to_single: "<<std::chrono::duration_cast<std::chrono::milliseconds>(done-started).count()<<std::endl;
+    REQUIRE(result[n-1]==Approx(resultReduce[n-1]));
+    REQUIRE(resultEstrin[n-1]==Approx(resultReduce[n-1]));
+}
+TEST_CASE("Test for_each_simd", "[Functional]"){
+    auto squareTestV=[](const auto& val){
+        return val*val+1;
+    };
+    for(int n: {0, 3, 8, 37}){
+        std::vector<double> testV=futilities::for_each(0, n+1, [](const auto& index){
+            return (double)index;
+        });
+        testV.pop_back();
+        auto expected=futilities::for_each(std::vector<double>(testV), [&](const auto& val, const auto& index){
+            return squareTestV(val);
+        });
+        REQUIRE(futilities::for_each_simd(std::vector<double>(testV), squareTestV)==expected);
+        REQUIRE(futilities::for_each_parallel_simd(std::vector<double>(testV), squareTestV)==expected);
+    }
+}
+TEST_CASE("Test for_each_simd unaligned", "[Functional]"){
+    //a view one element past an aligned start, so the range peels before the aligned packs
+    struct offset_view{
+        float* start;
+        float* data(){
+            return start;
+        }
+        int size() const{
+            return 37;
+        }
+    };
+    std::vector<float> testV(40, 2.0f);
+    float* data=testV.data()+1;
+    futilities::for_each_simd(offset_view{data}, [](const auto& val){
+        return val*3.0f;
+    });
+    REQUIRE(testV[0]==2.0f);
+    REQUIRE(std::vector<float>(data, data+37)==std::vector<float>(37, 6.0f));
+    REQUIRE(testV[38]==2.0f);
+    REQUIRE(testV[39]==2.0f);
+}
+TEST_CASE("Test for_each_simd_index", "[Functional]"){
+    std::vector<int> testV={5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    auto result=futilities::for_each_simd_index(std::move(testV), [](const auto& val, const auto& index){
+        return val*index;
+    });
+    REQUIRE(result==std::vector<int>({0, 6, 14, 24, 36, 50, 66, 84, 104, 126, 150}));
+    std::vector<double> doubles(11, 1.5);
+    auto scaled=futilities::for_each_simd_index(std::move(doubles), [](const auto& val, const auto& index){
+        return val*std::decay_t<decltype(val)>(index)+1.0;
+    });
+    for(int i=0; i<11; ++i){
+        REQUIRE(scaled[i]==1.5*i+1.0);
+    }
+    //indices above 2^24 stay exact for float, in packs as in the tail
+    const int offset=1<<25;
+    std::vector<float> floats(offset+11, 0.0f);
+    auto indices=futilities::for_each_simd_index(std::move(floats), [&](const auto& val, const auto& index){
+        return std::decay_t<decltype(val)>(index-offset);
+    });
+    for(int i=0; i<11; ++i){
+        REQUIRE(indices[offset+i]==(float)i);
+    }
+}
+template<typename T>
+void for_each_simd_benchmark(const std::string& name){
+    for(int n: {1000, 100000, 10000000}){
+        int repetitions=10000000/n;
+        std::vector<T> testV(n, T(1));
+        //reading an element between repetitions stops the compiler fusing them
+        T checksum=0;
+        auto squareTestV=[](const auto& val){
+            return val*val;
+        };
+        auto started = std::chrono::high_resolution_clock::now();
+        for(int r=0; r<repetitions; ++r){
+            testV=futilities::for_each(std::move(testV), [&](const auto& val, const auto& index){
+                return squareTestV(val);
+            });
+            checksum+=testV[r%n];
+        }
+        auto done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed futilities for_each "<<name<<" n="<<n<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+
+        started = std::chrono::high_resolution_clock::now();
+        for(int r=0; r<repetitions; ++r){
+            testV=futilities::for_each_simd(std::move(testV), squareTestV);
+            checksum+=testV[r%n];
+        }
+        done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed futilities for_each_simd "<<name<<" n="<<n<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+
+        started = std::chrono::high_resolution_clock::now();
+        for(int r=0; r<repetitions; ++r){
+            for(int i=0; i<n; ++i){
+                testV[i]=testV[i]*testV[i];
+            }
+            checksum+=testV[r%n];
+        }
+        done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed standard "<<name<<" n="<<n<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+        REQUIRE(checksum==T(3*repetitions));
+    }
+}
+template<typename T>
+double ulp_error(const T& result, const T& expected){
+    if(result==expected){
+        return 0;
+    }
+    const T magnitude=std::abs(expected);
+    const T ulp=std::nextafter(magnitude, std::numeric_limits<T>::infinity())-magnitude;
+    return std::abs((double)result-(double)expected)/ulp;
+}
+template<typename Tier, typename T, typename Fn, typename Reference>
+double max_ulp_error(T lower, T upper, int n, Fn&& fn, Reference&& reference){
+    double worst=0;
+    for(int i=0; i<n; ++i){
+        const T x=lower+(upper-lower)*i/(n-1);
+        worst=std::max(worst, ulp_error(fn(x), reference(x)));
+    }
+    return worst;
+}
+/**the precise kernels, which scalars and narrow packs skip for libm's exp, log and erf*/
+namespace kernels=futilities::math::detail;
+TEST_CASE("Test math precise matches libm", "[Functional]"){
+    using futilities::math::precise;
+    int n=200001;
+    REQUIRE(max_ulp_error<precise>(-745.0, 709.0, n, [](double x){return kernels::exp<precise>(x);}, [](double x){return exp(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(-1.0, 1.0, n, [](double x){return kernels::exp<precise>(x);}, [](double x){return exp(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(1e-300, 1e300, n, [](double x){return kernels::log<precise>(x);}, [](double x){return log(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(.5, 2.0, n, [](double x){return kernels::log<precise>(x);}, [](double x){return log(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(-100.0, 100.0, n, [](double x){return futilities::math::sin(x);}, [](double x){return sin(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(-100.0, 100.0, n, [](double x){return futilities::math::cos(x);}, [](double x){return cos(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(-6.0, 6.0, n, [](double x){return kernels::erf<precise>(x);}, [](double x){return erf(x);})<=4);
+    REQUIRE(max_ulp_error<precise>(-80.0f, 80.0f, n, [](float x){return kernels::exp<precise>(x);}, [](float x){return expf(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(1e-30f, 1e30f, n, [](float x){return kernels::log<precise>(x);}, [](float x){return logf(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(-100.0f, 100.0f, n, [](float x){return futilities::math::sin(x);}, [](float x){return sinf(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(-100.0f, 100.0f, n, [](float x){return futilities::math::cos(x);}, [](float x){return cosf(x);})<=1);
+    REQUIRE(max_ulp_error<precise>(-4.0f, 4.0f, n, [](float x){return kernels::erf<precise>(x);}, [](float x){return erff(x);})<=4);
+}
+TEST_CASE("Test math fast tier", "[Functional]"){
+    using futilities::math::fast;
+    for(int i=0; i<10001; ++i){
+        const double x=-20.0+40.0*i/10000;
+        REQUIRE(futilities::math::exp<fast>(x)==Approx(exp(x)).epsilon(2e-8));
+        REQUIRE(futilities::math::log<fast>(std::abs(x)+1e-3)==Approx(log(std::abs(x)+1e-3)).epsilon(2e-8));
+        REQUIRE(std::abs(futilities::math::sin<fast>(x)-sin(x))<2e-8);
+        REQUIRE(std::abs(futilities::math::cos<fast>(x)-cos(x))<2e-8);
+        REQUIRE(futilities::math::erf<fast>(x)==Approx(erf(x)).epsilon(1e-6));
+        const float xFloat=x;
+        REQUIRE(futilities::math::exp<fast>(xFloat)==Approx(expf(xFloat)).epsilon(1e-6));
+        REQUIRE(std::abs(futilities::math::sin<fast>(xFloat)-sinf(xFloat))<1e-6);
+    }
+}
+TEST_CASE("Test math special values", "[Functional]"){
+    using futilities::math::precise;
+    const double inf=std::numeric_limits<double>::infinity();
+    REQUIRE(kernels::exp<precise>(800.0)==inf);
+    REQUIRE(kernels::exp<precise>(-800.0)==0);
+    REQUIRE(kernels::exp<precise>(-inf)==0);
+    REQUIRE(kernels::exp<precise>(-740.0)==exp(-740.0));
+    REQUIRE(kernels::log<precise>(0.0)==-inf);
+    REQUIRE(kernels::log<precise>(inf)==inf);
+    REQUIRE(std::isnan(kernels::log<precise>(-1.0)));
+    REQUIRE(kernels::log<precise>(4.9e-324)==Approx(log(4.9e-324)));
+    REQUIRE(std::isnan(futilities::math::sin(inf)));
+    REQUIRE(kernels::erf<precise>(inf)==1);
+    REQUIRE(kernels::erf<precise>(-30.0)==-1);
+    REQUIRE(kernels::erf<precise>(1e-20)==erf(1e-20));
+    //precise scalars are libm's
+    REQUIRE(futilities::math::exp(0.3)==exp(0.3));
+    REQUIRE(futilities::math::log(0.3f)==logf(0.3f));
+    REQUIRE(futilities::math::erf(0.7)==erf(0.7));
+}
+TEST_CASE("Test math sin and cos large arguments", "[Functional]"){
+    using futilities::math::precise;
+    const std::vector<double> doubles({1e5, 1e6, 1e15, 3e15, 1e16, 9007199254740993.0*128, 1e20, 1e300});
+    for(auto x:doubles){
+        REQUIRE(ulp_error(futilities::math::sin(x), sin(x))<=2);
+        REQUIRE(ulp_error(futilities::math::cos(x), cos(x))<=2);
+        REQUIRE(ulp_error(futilities::math::sin(-x), sin(-x))<=2);
+    }
+    const std::vector<float> floats({1e5f, 1e6f, 1e8f, 1e15f, 1.5e16f, 1e30f});
+    for(auto x:floats){
+        REQUIRE(ulp_error(futilities::math::sin(x), sinf(x))<=2);
+        REQUIRE(ulp_error(futilities::math::cos(x), cosf(x))<=2);
+    }
+    int n=200001;
+    REQUIRE(max_ulp_error<precise>(-1e7, 1e7, n, [](double x){return futilities::math::sin(x);}, [](double x){return sin(x);})<=2);
+    REQUIRE(max_ulp_error<precise>(-1e5f, 1e5f, n, [](float x){return futilities::math::cos(x);}, [](float x){return cosf(x);})<=2);
+    //lanes on both sides of the reduction limit in one pack
+    std::vector<double> mixed({0.5, 1e6, 1e15, -2.0, 1e20, 3.0, -1e300, 7.0});
+    auto result=futilities::for_each_simd(std::vector<double>(mixed), [](const auto& val){
+        return futilities::math::sin(val);
+    });
+    for(int i=0; i<(int)mixed.size(); ++i){
+        REQUIRE(ulp_error(result[i], sin(mixed[i]))<=2);
+    }
+    REQUIRE(std::isnan(futilities::math::cos(std::numeric_limits<float>::quiet_NaN())));
+}
+TEST_CASE("Test math with for_each_simd", "[Functional]"){
+    int n=1003;
+    std::vector<double> testV(n);
+    for(int i=0; i<n; ++i){
+        testV[i]=-3.0+.01*i;
+    }
+    auto result=futilities::for_each_simd(std::vector<double>(testV), [](const auto& val){
+        auto sinCos=futilities::math::sincos(val);
+        return futilities::math::exp(val)*sinCos.first+futilities::math::erf(val)*sinCos.second+futilities::math::log(val*val+1.0);
+    });
+    for(int i=0; i<n; ++i){
+        const double x=testV[i];
+        REQUIRE(result[i]==Approx(exp(x)*sin(x)+erf(x)*cos(x)+log(x*x+1.0)));
+    }
+}
+TEST_CASE("Test math time", "[Functional]"){
+    int n=1000000;
+    std::vector<double> testV(n);
+    for(int i=0; i<n; ++i){
+        testV[i]=-10.0+20.0*i/n;
+    }
+    auto time=[&](const std::string& name, auto&& fn){
+        std::vector<double> copy(testV);
+        auto started = std::chrono::high_resolution_clock::now();
+        auto result=fn(std::move(copy));
+        auto done = std::chrono::high_resolution_clock::now();
+        std::cout << "Speed "<<name<<": "<<std::chrono::duration_cast<std::chrono::microseconds>(done-started).count()<<std::endl;
+        return result;
+    };
+    auto libm=time("libm exp", [](auto&& v){
+        return futilities::for_each(std::move(v), [](const auto& val, const auto& index){
+            return exp(val);
+        });
+    });
+    auto precise=time("futilities math::exp", [](auto&& v){
+        return futilities::for_each_simd(std::move(v), [](const auto& val){
+            return futilities::math::exp(val);
+        });
+    });
+    auto fast=time("futilities math::exp<fast>", [](auto&& v){
+        return futilities::for_each_simd(std::move(v), [](const auto& val){
+            return futilities::math::exp<futilities::math::fast>(val);
+        });
+    });
+    REQUIRE(precise[n/3]==Approx(libm[n/3]));
+    REQUIRE(fast[n/3]==Approx(libm[n/3]));
+    auto libmCos=time("libm cos", [](auto&& v){
+        return futilities::for_each(std::move(v), [](const auto& val, const auto& index){
+            return cos(val);
+        });
+    });
+    auto preciseCos=time("futilities math::cos", [](auto&& v){
+        return futilities::for_each_simd(std::move(v), [](const auto& val){
+            return futilities::math::cos(val);
+        });
+    });
+    REQUIRE(preciseCos[n/3]==Approx(libmCos[n/3]));
+    auto libmLog=time("libm log", [](auto&& v){
+        return futilities::for_each(std::move(v), [](const auto& val, const auto& index){
+            return log(val*val+1.0);
+        });
+    });
+    auto preciseLog=time("futilities math::log", [](auto&& v){
+        return futilities::for_each_simd(std::move(v), [](const auto& val){
+            return futilities::math::log(val*val+1.0);
+        });
+    });
+    REQUIRE(preciseLog[n/3]==Approx(libmLog[n/3]));
+    auto libmErf=time("libm erf", [](auto&& v){
+        return futilities::for_each(std::move(v), [](const auto& val, const auto& index){
+            return erf(val);
+        });
+    });
+    auto preciseErf=time("futilities math::erf", [](auto&& v){
+        return futilities::for_each_simd(std::move(v), [](const auto& val){
+            return futilities::math::erf(val);
+        });
+    });
+    auto fastErf=time("futilities math::erf<fast>", [](auto&& v){
+        return futilities::for_each_simd(std::move(v), [](const auto& val){
+            return futilities::math::erf<futilities::math::fast>(val);
+        });
+    });
+    REQUIRE(preciseErf[n/3]==Approx(libmErf[n/3]));
+    REQUIRE(fastErf[n/3]==Approx(libmErf[n/3]));
+}
+TEST_CASE("Test for_each_simd time", "[Functional]"){
+    for_each_simd_benchmark<double>("double");
+    for_each_simd_benchmark<float>("float");
+    for_each_simd_benchmark<int>("int");
+}
 TEST_CASE("Test for_each time", "[Functional]"){
     int n=100000000;
     std::vector<int> testV(n, 0);